@@ -0,0 +1,122 @@
+/*
+    Copyright (c) 2025 Om Rawaley
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../lib/batch.h"
+
+// Batch scaling benchmark: runs the same set of headless instances with 1 to N worker threads
+// and reports aggregate frames/sec for each thread count
+
+struct Measurement
+{
+    double framesPerSecond;
+    double firstAddSeconds;  // Constructs the GameBoy and maps the ROM
+    double otherAddSeconds;  // Average of the rest, which share the first instance's ROM image
+};
+
+static Measurement measure(const char* romPath, const u32 threads, const u32 instances, const u64 frames)
+{
+    BatchRunner runner(threads);
+    Measurement measurement = {0, 0, 0};
+
+    for(u32 i = 0; i < instances; ++i)
+    {
+        BatchRunner::Job job;
+        job.romPath = romPath;
+        job.options.skipBootROM = true;
+        job.frameBudget = frames;
+
+        // Instances tap A at different rates so they don't all run the same code in step
+        const u64 period = 8 + i % 32;
+        job.input = [period](GameBoy& gameboy, const u64 frame)
+        {
+            if(frame % period == 0)
+                gameboy.pressButton(Joypad::Button::A);
+            else if(frame % period == 2)
+                gameboy.releaseButton(Joypad::Button::A);
+        };
+
+        const auto addStart = std::chrono::steady_clock::now();
+        const bool added = runner.add(job).has_value();
+        const double addSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - addStart).count();
+
+        if(!added)
+        {
+            fprintf(stderr, "ERROR::CLI::COULD_NOT_LOAD_ROM\n");
+            exit(EXIT_FAILURE);
+        }
+
+        if(i == 0)
+            measurement.firstAddSeconds = addSeconds;
+        else
+            measurement.otherAddSeconds += addSeconds / (instances - 1);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    runner.run();
+    const auto end = std::chrono::steady_clock::now();
+
+    measurement.framesPerSecond = runner.getTotalFrames() / std::chrono::duration<double>(end - start).count();
+    return measurement;
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "ERROR::CLI::NO_ROM_PROVIDED\n");
+        fprintf(stderr, "Usage: gb-batchbench <path-to-rom> [instances] [frames] [max-threads]\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const long instances = argc >= 3 ? atol(argv[2]) : 256;
+    const long frames = argc >= 4 ? atol(argv[3]) : 600;
+    const long maxThreads = argc >= 5 ? atol(argv[4]) : std::thread::hardware_concurrency();
+
+    if(instances <= 0 || frames <= 0 || maxThreads <= 0)
+    {
+        fprintf(stderr, "ERROR::CLI::INVALID_ARGUMENT\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Powers of two up to the core count, then the core count itself
+    std::vector<u32> threadCounts;
+    for(u32 threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    printf("Instances:  %ld x %ld frames\n", instances, frames);
+
+    double baseline = 0;
+    for(const u32 threads : threadCounts)
+    {
+        const Measurement measurement = measure(argv[1], threads, instances, frames);
+        const double framesPerSecond = measurement.framesPerSecond;
+
+        if(threads == 1)
+        {
+            printf("Add:        first instance %.1f us, others %.1f us each\n", measurement.firstAddSeconds * 1e6, measurement.otherAddSeconds * 1e6);
+            printf("%8s %14s %9s %11s\n", "Threads", "Frames/sec", "Speedup", "Efficiency");
+            baseline = framesPerSecond;
+        }
+
+        printf("%8u %14.1f %8.2fx %10.1f%%\n", threads, framesPerSecond, framesPerSecond / baseline, 100.0 * framesPerSecond / baseline / threads);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+/*
+    Copyright (c) 2025 Om Rawaley
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <chrono>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "../lib/gameboy.h"
+#include "../lib/decode.h"
+
+// Headless throughput benchmark: runs a ROM without a window as fast as possible
+
+// Emulated frames are 69905 cycles of the 4194304 Hz clock, so 1x speed is one frame per frameSeconds
+constexpr double frameCycles = 69905.0;
+constexpr double frameSeconds = frameCycles / 4194304.0;
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "ERROR::CLI::NO_ROM_PROVIDED\n");
+        fprintf(stderr, "Usage: gb-bench <path-to-rom> [frames] [path-to-boot-rom]\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const long frames = argc >= 3 ? atol(argv[2]) : 3600;
+
+    if(frames <= 0)
+    {
+        fprintf(stderr, "ERROR::CLI::INVALID_FRAME_COUNT\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Forcing the tile decode path compares the SIMD paths on one machine. Set before any
+    // GameBoy exists, the path is shared by every instance in the process.
+    if(const char* decode = getenv("GB_DECODE"))
+    {
+        const bool set = strcmp(decode, "scalar") == 0 ? Decode::setPath(Decode::Path::Scalar) : strcmp(decode, "sse2") == 0 ? Decode::setPath(Decode::Path::SSE2) : strcmp(decode, "avx2") == 0 ? Decode::setPath(Decode::Path::AVX2) : false;
+
+        if(!set)
+        {
+            fprintf(stderr, "ERROR::CLI::UNSUPPORTED_DECODE_PATH\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    Options options;
+    options.skipBootROM = argc < 4;
+
+    #ifdef CPU_JIT
+        options.jitLockstep = getenv("GB_JIT_LOCKSTEP") != nullptr;
+    #endif
+
+    GameBoy gameboy(options);
+
+    if(!gameboy.loadROM(argv[1]))
+    {
+        fprintf(stderr, "ERROR::CLI::COULD_NOT_LOAD_ROM\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const bool rewind = getenv("GB_REWIND") != nullptr;
+    if(rewind)
+        gameboy.setRewind(2, 4 * 1024 * 1024);
+
+    if(argc >= 4)
+        gameboy.loadBootROM(argv[3]);
+
+    const long runAheadFrames = getenv("GB_RUN_AHEAD") ? atol(getenv("GB_RUN_AHEAD")) : 0;
+
+    // runAhead takes a u8
+    if(runAheadFrames < 0 || runAheadFrames > 255)
+    {
+        fprintf(stderr, "ERROR::CLI::INVALID_RUN_AHEAD_FRAME_COUNT\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for(long i = 0; i < frames; ++i)
+        gameboy.runAhead(runAheadFrames);
+
+    const auto end = std::chrono::steady_clock::now();
+
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    const double framesPerSecond = frames / seconds;
+
+    printf("ROM:        %s\n", gameboy.getTitle().c_str());
+    printf("Frames:     %ld\n", frames);
+    printf("Decode:     %s\n", Decode::getPath() == Decode::Path::AVX2 ? "AVX2" : Decode::getPath() == Decode::Path::SSE2 ? "SSE2" : "scalar");
+    printf("Time:       %.3f s\n", seconds);
+    printf("Frames/sec: %.1f\n", framesPerSecond);
+    printf("Speed:      %.2fx\n", framesPerSecond * frameSeconds);
+    printf("ns/frame:   %.0f\n", seconds * 1e9 / frames);
+
+    const CPU::IdleLoopStats idle = gameboy.getIdleLoopStats();
+    printf("Idle loops: %llu skipped, %.1f%% of cycles\n", static_cast<unsigned long long>(idle.loops), 100.0 * idle.cycles / (frames * frameCycles));
+
+    if(runAheadFrames)
+    {
+        const GameBoy::RunAheadStats runAhead = gameboy.getRunAheadStats();
+        printf("Run-ahead:  %ld frames, save %.2f us, load %.2f us, %.0f us/frame\n", runAheadFrames, runAhead.saveNanoseconds / 1e3 / runAhead.frames, runAhead.loadNanoseconds / 1e3 / runAhead.frames, runAhead.totalNanoseconds / 1e3 / runAhead.frames);
+    }
+
+    if(rewind)
+    {
+        const Rewind::Stats history = gameboy.getRewindStats();
+        printf("Rewind:     %llu snapshots, %llu skipped, %u kept in %zu bytes (%.1f s)\n", static_cast<unsigned long long>(history.snapshots), static_cast<unsigned long long>(history.skipped), history.history, history.bytes, history.history * 2 * frameSeconds);
+    }
+
+    // Round trip the final state to measure save state cost
+    constexpr int stateRounds = 1000;
+    std::vector<u8> state(gameboy.getStateSize());
+
+    const auto saveStart = std::chrono::steady_clock::now();
+    for(int i = 0; i < stateRounds; ++i)
+        gameboy.saveState(state);
+    const auto loadStart = std::chrono::steady_clock::now();
+    for(int i = 0; i < stateRounds; ++i)
+        gameboy.loadState(state);
+    const auto loadEnd = std::chrono::steady_clock::now();
+
+    printf("Save state: %zu bytes, save %.2f us, load %.2f us\n", state.size(), std::chrono::duration<double, std::micro>(loadStart - saveStart).count() / stateRounds, std::chrono::duration<double, std::micro>(loadEnd - loadStart).count() / stateRounds);
+
+    #ifdef CPU_JIT
+        const CPU::JITStats jit = gameboy.getJITStats();
+        printf("JIT:        %llu blocks compiled\n", static_cast<unsigned long long>(jit.blocks));
+
+        if(gameboy.options.jitLockstep)
+            printf("Lockstep:   %llu blocks checked, %llu mismatches\n", static_cast<unsigned long long>(jit.checks), static_cast<unsigned long long>(jit.mismatches));
+    #endif
+}
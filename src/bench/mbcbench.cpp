@@ -0,0 +1,132 @@
+/*
+    Copyright (c) 2025 Om Rawaley
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../lib/gameboy.h"
+
+// Mapper micro-benchmark: times the bus paths that reach the cart's MBC, bank switches (an MBC
+// register write and the page remap it causes) and reads and writes that miss the page tables
+
+class MBCBench
+{
+    private:
+        GameBoy gameboy;
+
+        volatile u32 sink;
+
+        template<typename Body>
+        double measure(const u32 iterations, const u32 repeats, Body body)
+        {
+            double best = 0;
+
+            for(u32 repeat = 0; repeat < repeats; ++repeat)
+            {
+                const auto start = std::chrono::steady_clock::now();
+
+                for(u32 i = 0; i < iterations; ++i)
+                    body(i);
+
+                const auto end = std::chrono::steady_clock::now();
+
+                const double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+                if(repeat == 0 || ns < best)
+                    best = ns;
+            }
+
+            return best;
+        }
+
+    public:
+        MBCBench(const char* romPath) : gameboy({.skipBootROM = true}), sink(0)
+        {
+            this->gameboy.loadROM(romPath);
+        }
+
+        bool isLoaded() const
+        {
+            return this->gameboy.cart.rom;
+        }
+
+        void run(const u32 iterations, const u32 repeats)
+        {
+            Bus& bus = this->gameboy.bus;
+            Cart& cart = this->gameboy.cart;
+
+            const u16 banks = cart.romBanks;
+
+            // Enable cart RAM so RAM accesses reach it
+            bus.writeByte(0x0000, 0x0A);
+
+            const double bankSwitch = this->measure(iterations, repeats, [&bus, banks](const u32 i)
+            {
+                bus.writeByte(0x2000, 1 + i % (banks - 1));
+            });
+
+            const double romRead = this->measure(iterations, repeats, [this, &cart](const u32 i)
+            {
+                this->sink = this->sink + cart.readByte((i * 0x9E5) & 0x7FFF);
+            });
+
+            const double ramRead = this->measure(iterations, repeats, [this, &cart](const u32 i)
+            {
+                this->sink = this->sink + cart.readByte(0xA000 + ((i * 0x9E5) & 0x1FFF));
+            });
+
+            const double ramWrite = this->measure(iterations, repeats, [&cart](const u32 i)
+            {
+                cart.writeByte(0xA000 + ((i * 0x9E5) & 0x1FFF), i);
+            });
+
+            printf("ROM:          %s\n", this->gameboy.getTitle().c_str());
+            printf("Cart type:    0x%02X, %u ROM banks, %u RAM banks\n", static_cast<u8>(cart.type), cart.romBanks, cart.ramBanks);
+            printf("Bank switch:  %.2f ns\n", bankSwitch);
+            printf("ROM read:     %.2f ns\n", romRead);
+            printf("RAM read:     %.2f ns\n", ramRead);
+            printf("RAM write:    %.2f ns\n", ramWrite);
+        }
+};
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "ERROR::CLI::NO_ROM_PROVIDED\n");
+        fprintf(stderr, "Usage: gb-mbcbench <path-to-rom> [iterations] [repeats]\n");
+        exit(EXIT_FAILURE);
+    }
+
+    const long iterations = argc >= 3 ? atol(argv[2]) : 1000000;
+    const long repeats = argc >= 4 ? atol(argv[3]) : 5;
+
+    if(iterations <= 0 || repeats <= 0)
+    {
+        fprintf(stderr, "ERROR::CLI::INVALID_ITERATION_COUNT\n");
+        exit(EXIT_FAILURE);
+    }
+
+    MBCBench bench(argv[1]);
+
+    if(!bench.isLoaded())
+    {
+        fprintf(stderr, "ERROR::CLI::COULD_NOT_LOAD_ROM\n");
+        exit(EXIT_FAILURE);
+    }
+
+    bench.run(iterations, repeats);
+}
\ No newline at end of file
@@ -0,0 +1,180 @@
+/*
+    Copyright (c) 2025 Om Rawaley
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/gameboy.h"
+
+// Per-opcode micro-benchmark: executes every base and CB-prefixed opcode in isolation
+// against a flat 64 KiB RAM mapped into every Bus page and prints ns/instruction as JSON
+
+class OpcodeBench
+{
+    private:
+        Options options = {.skipBootROM = true};
+        ErrorCollector errors;
+
+        Scheduler scheduler;
+        Bus bus;
+        Cart cart;
+        CPU cpu;
+        Timer timer;
+        PPU ppu;
+        Joypad joypad;
+        Interrupts interrupts;
+
+        u8 memory[0x10000];
+
+        volatile u32 sink;
+
+        void mapFlatMemory()
+        {
+            memset(this->memory, 0, sizeof(this->memory));
+
+            for(u16 page = 0; page < 0x100; ++page)
+            {
+                this->bus.readPages[page] = &this->memory[page << 8];
+                this->bus.writePages[page] = &this->memory[page << 8];
+            }
+        }
+
+    public:
+        struct Result
+        {
+            u8 opcode;
+            bool extended;
+            double ns;
+            u8 cycles;
+        };
+
+        OpcodeBench() : bus(this->cart, this->cpu, this->timer, this->ppu, this->joypad, this->interrupts, this->options, this->errors), cart(this->errors), cpu(this->bus, this->interrupts, this->scheduler, this->options, this->errors), timer(this->bus, this->interrupts, this->scheduler, this->options), ppu(this->bus, this->interrupts, this->scheduler, this->options), joypad(this->bus, this->interrupts, this->options), interrupts(this->options), sink(0)
+        {
+
+        }
+
+        Result measure(const u8 opcode, const bool extended, const u32 iterations, const u32 repeats)
+        {
+            double best = 0;
+            u8 cycles = 0;
+
+            for(u32 repeat = 0; repeat < repeats; ++repeat)
+            {
+                this->mapFlatMemory();
+                this->cpu.restart();
+                this->cpu.pc = 0xC000;
+                this->cpu.sp = 0xD000;
+                this->cpu.hl.pair = 0xC800;
+                this->cpu.operand = 0;
+
+                u32 total = 0;
+
+                const auto start = std::chrono::steady_clock::now();
+
+                for(u32 i = 0; i < iterations; ++i)
+                {
+                    // Rewind so every iteration branches from the same place
+                    this->cpu.pc = 0xC000;
+                    this->cpu.halted = false;
+                    total += extended ? this->cpu.executeExtendedOpcode(opcode) : this->cpu.executeOpcode(opcode);
+                }
+
+                const auto end = std::chrono::steady_clock::now();
+
+                this->sink = this->sink + total;
+                cycles = total / iterations;
+
+                const double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+                if(repeat == 0 || ns < best)
+                    best = ns;
+            }
+
+            return Result{opcode, extended, best, cycles};
+        }
+};
+
+static bool isIllegalOpcode(const u8 opcode)
+{
+    switch(opcode)
+    {
+        case 0xCB: // Measured through the extended table
+        case 0xD3: case 0xDB: case 0xDD: case 0xE3: case 0xE4: case 0xEB:
+        case 0xEC: case 0xED: case 0xF4: case 0xFC: case 0xFD:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void printResults(const char* name, const std::vector<OpcodeBench::Result>& results, const bool last)
+{
+    printf("  \"%s\": [\n", name);
+
+    for(size_t i = 0; i < results.size(); ++i)
+    {
+        printf("    {\"opcode\": \"0x%02X\", \"ns\": %.3f, \"cycles\": %u}%s\n", results[i].opcode, results[i].ns, results[i].cycles, i + 1 < results.size() ? "," : "");
+    }
+
+    printf("  ]%s\n", last ? "" : ",");
+}
+
+int main(int argc, char* argv[])
+{
+    const long iterations = argc >= 2 ? atol(argv[1]) : 1000000;
+    const long repeats = argc >= 3 ? atol(argv[2]) : 5;
+
+    if(iterations <= 0 || repeats <= 0)
+    {
+        fprintf(stderr, "ERROR::CLI::INVALID_ITERATION_COUNT\n");
+        fprintf(stderr, "Usage: gb-opbench [iterations] [repeats]\n");
+        exit(EXIT_FAILURE);
+    }
+
+    OpcodeBench bench;
+
+    std::vector<OpcodeBench::Result> base;
+    std::vector<OpcodeBench::Result> extended;
+
+    for(u16 opcode = 0; opcode < 0x100; ++opcode)
+    {
+        if(!isIllegalOpcode(opcode))
+            base.push_back(bench.measure(opcode, false, iterations, repeats));
+
+        extended.push_back(bench.measure(opcode, true, iterations, repeats));
+    }
+
+    printf("{\n");
+    printf("  \"iterations\": %ld,\n", iterations);
+    printf("  \"repeats\": %ld,\n", repeats);
+    printResults("base", base, false);
+    printResults("extended", extended, true);
+    printf("}\n");
+
+    // Human readable summary of the slowest handlers
+    std::vector<OpcodeBench::Result> all = base;
+    all.insert(all.end(), extended.begin(), extended.end());
+    std::sort(all.begin(), all.end(), [](const OpcodeBench::Result& a, const OpcodeBench::Result& b){ return a.ns > b.ns; });
+
+    fprintf(stderr, "Slowest handlers:\n");
+    for(size_t i = 0; i < 10 && i < all.size(); ++i)
+    {
+        fprintf(stderr, "  %s0x%02X  %.2f ns\n", all[i].extended ? "CB " : "", all[i].opcode, all[i].ns);
+    }
+}
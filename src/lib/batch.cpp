@@ -0,0 +1,233 @@
+#include "batch.h"
+
+#include <algorithm>
+
+BatchRunner::BatchRunner(const u32 threads) : threadCount(std::max<u32>(threads, 1)), generation(0), stop(false), remaining(0), queued(0)
+{
+    this->queues = std::make_unique<Queue[]>(this->threadCount);
+
+    for(u32 id = 0; id < this->threadCount; ++id)
+        this->workers.emplace_back(&BatchRunner::work, this, id);
+}
+
+BatchRunner::~BatchRunner()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+    }
+
+    this->start.notify_all();
+
+    for(std::thread& worker : this->workers)
+        worker.join();
+}
+
+std::optional<u32> BatchRunner::add(const Job& job)
+{
+    if(!job.frameBudget && !job.done)
+        return std::nullopt;
+
+    Instance instance;
+    instance.gameboy = std::make_unique<GameBoy>(job.options);
+
+    if(!instance.gameboy->loadROM(job.romPath))
+        return std::nullopt;
+
+    instance.job = job;
+    instance.result = {0, false, false};
+
+    this->instances.push_back(std::move(instance));
+
+    return this->instances.size() - 1;
+}
+
+void BatchRunner::run()
+{
+    size_t unfinished = 0;
+
+    for(const Instance& instance : this->instances)
+        unfinished += !instance.result.finished;
+
+    if(!unfinished)
+        return;
+
+    // Set before the queues fill up, a worker still leaving the last run may already take from them
+    this->remaining = unfinished;
+
+    for(u32 index = 0; index < this->instances.size(); ++index)
+    {
+        if(this->instances[index].result.finished)
+            continue;
+
+        Queue& queue = this->queues[index % this->threadCount];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.instances.push_back(index);
+        ++this->queued;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        ++this->generation;
+    }
+
+    this->start.notify_all();
+    this->available.notify_all();
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->finished.wait(lock, [this]() { return this->remaining == 0; });
+}
+
+u32 BatchRunner::getThreadCount() const
+{
+    return this->threadCount;
+}
+
+u32 BatchRunner::getInstanceCount() const
+{
+    return this->instances.size();
+}
+
+GameBoy& BatchRunner::getInstance(const u32 index)
+{
+    return *this->instances[index].gameboy;
+}
+
+const BatchRunner::Result& BatchRunner::getResult(const u32 index) const
+{
+    return this->instances[index].result;
+}
+
+u64 BatchRunner::getTotalFrames() const
+{
+    u64 frames = 0;
+
+    for(const Instance& instance : this->instances)
+        frames += instance.result.frames;
+
+    return frames;
+}
+
+// =================================================================================
+// Workers
+// =================================================================================
+
+void BatchRunner::work(const u32 id)
+{
+    u64 seen = 0;
+
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->start.wait(lock, [this, seen]() { return this->stop || this->generation != seen; });
+
+            if(this->stop)
+                return;
+
+            seen = this->generation;
+        }
+
+        while(this->remaining > 0)
+        {
+            u32 index;
+
+            // Everything left is in flight on other workers, sleep until one of them puts an instance back
+            if(!this->take(id, index))
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->available.wait(lock, [this]() { return this->queued > 0 || this->remaining == 0; });
+                continue;
+            }
+
+            if(!this->runSlice(this->instances[index]))
+            {
+                {
+                    std::lock_guard<std::mutex> lock(this->queues[id].mutex);
+                    this->queues[id].instances.push_back(index);
+                    ++this->queued;
+                }
+
+                // Notifying under the lock orders it after a waiter's check of queued, so the wake up can't be lost
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->available.notify_one();
+                continue;
+            }
+
+            if(--this->remaining == 0)
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->finished.notify_all();
+                this->available.notify_all();
+            }
+        }
+    }
+}
+
+bool BatchRunner::take(const u32 id, u32& index)
+{
+    {
+        Queue& queue = this->queues[id];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if(!queue.instances.empty())
+        {
+            index = queue.instances.front();
+            queue.instances.pop_front();
+            --this->queued;
+            return true;
+        }
+    }
+
+    for(u32 i = 1; i < this->threadCount; ++i)
+    {
+        Queue& victim = this->queues[(id + i) % this->threadCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if(!victim.instances.empty())
+        {
+            index = victim.instances.back();
+            victim.instances.pop_back();
+            --this->queued;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool BatchRunner::runSlice(Instance& instance)
+{
+    GameBoy& gameboy = *instance.gameboy;
+    Result& result = instance.result;
+
+    for(u32 i = 0; i < BatchRunner::sliceFrames; ++i)
+    {
+        if(instance.job.frameBudget && result.frames >= instance.job.frameBudget)
+        {
+            result.finished = true;
+            return true;
+        }
+
+        if(instance.job.input)
+            instance.job.input(gameboy, result.frames);
+
+        gameboy.step();
+        ++result.frames;
+
+        if(instance.job.done && instance.job.done(gameboy, result.frames))
+        {
+            result.finished = true;
+            result.completed = true;
+            return true;
+        }
+    }
+
+    if(instance.job.frameBudget && result.frames >= instance.job.frameBudget)
+    {
+        result.finished = true;
+        return true;
+    }
+
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <condition_variable>
+#include <string>
+#include <thread>
+#include <vector>
+#include "types.h"
+#include "gameboy.h"
+
+// Runs many headless GameBoy instances across a pool of threads. Every worker owns a queue of
+// instances and advances the one at its front by a slice of frames, then puts it back. A worker
+// whose queue runs dry steals from the back of the others', so instances that finish early or
+// run slowly don't leave cores idle.
+class BatchRunner
+{
+    public:
+        struct Job
+        {
+            std::string romPath;
+            Options options;
+
+            // Frames to run at most, 0 runs until done returns true
+            u64 frameBudget = 0;
+
+            // Called before every frame with the number of frames run so far, for pressing and releasing buttons
+            std::function<void(GameBoy& gameboy, const u64 frame)> input;
+
+            // Called after every frame, returning true finishes the instance early
+            std::function<bool(GameBoy& gameboy, const u64 frame)> done;
+        };
+
+        struct Result
+        {
+            u64 frames;
+            bool finished;
+            bool completed; // Finished because done returned true rather than the budget running out
+        };
+
+    private:
+        // Frames an instance runs before it goes back into a queue where it can be stolen
+        static constexpr u32 sliceFrames = 16;
+
+        struct Instance
+        {
+            std::unique_ptr<GameBoy> gameboy;
+            Job job;
+            Result result;
+        };
+
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<u32> instances;
+        };
+
+        std::vector<Instance> instances;
+        std::unique_ptr<Queue[]> queues;
+
+        const u32 threadCount;
+        std::vector<std::thread> workers;
+
+        // Bumped by run to wake the workers
+        u64 generation;
+        bool stop;
+
+        std::atomic<size_t> remaining;
+
+        // Instances sitting in a queue, counted under the queue's lock so it never runs ahead of the queues
+        std::atomic<size_t> queued;
+
+        std::mutex mutex;
+        std::condition_variable start;
+        std::condition_variable finished;
+
+        // Signalled when an instance is put back or the last one finishes, idle workers sleep on it
+        std::condition_variable available;
+
+        void work(const u32 id);
+        bool take(const u32 id, u32& index);
+        bool runSlice(Instance& instance);
+
+    public:
+        BatchRunner(const u32 threads = std::thread::hardware_concurrency());
+        ~BatchRunner();
+
+        BatchRunner(const BatchRunner&) = delete;
+        BatchRunner& operator=(const BatchRunner&) = delete;
+
+        // Create an instance and load its ROM on the calling thread, returns its index. A job whose
+        // ROM doesn't load, or with neither a frame budget nor a done callback, is refused. The
+        // callbacks of one instance never run concurrently, different instances' do.
+        std::optional<u32> add(const Job& job);
+
+        // Advance every unfinished instance until its budget runs out or done returns true
+        void run();
+
+        u32 getThreadCount() const;
+        u32 getInstanceCount() const;
+
+        GameBoy& getInstance(const u32 index);
+        const Result& getResult(const u32 index) const;
+
+        // Frames run by all instances together
+        u64 getTotalFrames() const;
+};
\ No newline at end of file
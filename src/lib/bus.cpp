@@ -2,7 +2,10 @@
 
 #include <string.h>
 #include <iostream>
-#include <format>
+
+#ifdef ERROR
+    #include <format>
+#endif
 
 #include "cart.h"
 #include "cpu.h"
@@ -14,7 +17,7 @@
 #include "gameboy.h"
 #include "error.h"
 
-Bus::Bus(Cart& cart, CPU& cpu, Timer& timer, PPU& ppu, Joypad& joypad, Interrupts& interrupts) : disableBootRom(false), cart(cart), cpu(cpu), timer(timer), ppu(ppu), joypad(joypad), interrupts(interrupts)
+Bus::Bus(Cart& cart, CPU& cpu, Timer& timer, PPU& ppu, Joypad& joypad, Interrupts& interrupts, const Options& options, ErrorCollector& errors) : disableBootRom(false), cart(cart), cpu(cpu), timer(timer), ppu(ppu), joypad(joypad), interrupts(interrupts), options(options), errors(errors)
 {
     this->restart();
 }
@@ -27,11 +30,91 @@ void Bus::restart()
     memset(this->oam, 0, 0xA0);
     memset(this->hram, 0, 0x7F);
 
-    this->disableBootRom = GameBoy::skipBootROM ? true : false;
+    this->disableBootRom = this->options.skipBootROM;
+
+    // OAM, IO and HRAM always take the slow path, the cart is mapped once a ROM is loaded
+    for(u16 page = 0x00; page <= 0xFF; ++page)
+    {
+        this->readPages[page] = nullptr;
+        this->writePages[page] = nullptr;
+    }
+
+    // VRAM, tile data writes take the slow path so the PPU can invalidate its decoded tiles
+    for(u16 page = 0x80; page <= 0x9F; ++page)
+    {
+        this->readPages[page] = &this->vram[(page - 0x80) << 8];
+        this->writePages[page] = page >= 0x98 ? &this->vram[(page - 0x80) << 8] : nullptr;
+    }
+
+    // WRAM and its echo
+    for(u16 page = 0xC0; page <= 0xFD; ++page)
+    {
+        this->readPages[page] = &this->wram[((page - 0xC0) & 0x1F) << 8];
+        this->writePages[page] = &this->wram[((page - 0xC0) & 0x1F) << 8];
+    }
+}
+
+void Bus::saveState(StateWriter& state) const
+{
+    state.write(this->vram);
+    state.write(this->wram);
+    state.write(this->oam);
+    state.write(this->hram);
+    state.write(this->disableBootRom);
+}
+
+void Bus::loadState(StateReader& state)
+{
+    state.read(this->vram);
+    state.read(this->wram);
+    state.read(this->oam);
+    state.read(this->hram);
+    state.read(this->disableBootRom);
+
+    // Every WRAM page goes back to the fast path, the CPU drops its decoded WRAM blocks
+    for(u16 page = 0xC0; page <= 0xFD; ++page)
+        this->writePages[page] = &this->wram[((page - 0xC0) & 0x1F) << 8];
+}
+
+void Bus::remap()
+{
+    // ROM writes are MBC control writes and always take the slow path. Mappers switch ROM in
+    // whole 16 KiB banks, so each bank is looked up once.
+    for(u16 bank = 0x00; bank <= 0x40; bank += 0x40)
+    {
+        const u8* base = this->cart.mapROM(bank << 8);
+
+        for(u16 page = 0; page < 0x40; ++page)
+            this->readPages[bank + page] = base ? base + (page << 8) : nullptr;
+    }
+
+    if(!this->disableBootRom)
+        this->readPages[0x00] = this->bootRom;
+
+    // Cart RAM is one 8 KiB bank, writes are looked up per page for the save file's dirty tracking
+    const u8* ram = this->cart.mapRAM(0xA000);
+
+    for(u16 page = 0xA0; page <= 0xBF; ++page)
+    {
+        this->readPages[page] = ram ? ram + ((page - 0xA0) << 8) : nullptr;
+        this->writePages[page] = ram ? this->cart.mapRAMWrite(page << 8) : nullptr;
+    }
+}
+
+void Bus::protectCodePage(const u8 page)
+{
+    this->writePages[0xC0 + page] = nullptr;
+
+    if(0xE0 + page <= 0xFD)
+        this->writePages[0xE0 + page] = nullptr;
 }
 
-u8 Bus::readByte(const u16 addr) const
+u8 Bus::readSlow(const u16 addr) const
 {
+    // HRAM shares its page with the IO registers
+    if(Util::isAddressBetween(addr, 0xFF80, 0xFFFE))
+        return this->hram[addr - 0xFF80];
+
     if(!this->disableBootRom)
     {
         if(Util::isAddressBetween(addr, 0x0000, 0x00FF))
@@ -61,19 +144,17 @@ u8 Bus::readByte(const u16 addr) const
     if(Util::isAddressBetween(addr, 0xFE00, 0xFE9F))
         return this->oam[addr - 0xFE00];
 
-    if(Util::isAddressBetween(addr, 0xFF80, 0xFFFE))
-        return this->hram[addr - 0xFF80];
-
     switch(addr)
     {
         case 0xFF00:
+            this->joypad.checkButtons();
             return this->joypad.joyp;
             break;
         case 0xFF04:
-            return (this->timer.div & 0xFF00) >> 8;
+            return this->timer.readDIV();
             break;
         case 0xFF05:
-            return this->timer.tima;
+            return this->timer.readTIMA();
             break;
         case 0xFF06:
             return this->timer.tma;
@@ -126,7 +207,7 @@ u8 Bus::readByte(const u16 addr) const
             break;
         default:
             #ifdef ERROR
-                ErrorCollector::reportError(std::format("INVALID_READ_ADDRESS {:X}\n", addr), ErrorModule::Bus);
+                this->errors.reportError(std::format("INVALID_READ_ADDRESS {:X}\n", addr), ErrorModule::Bus);
             #endif
             break;
     }
@@ -134,47 +215,60 @@ u8 Bus::readByte(const u16 addr) const
     return 0xFF;
 }
 
-void Bus::writeByte(const u16 addr, const u8 val)
+void Bus::writeSlow(const u16 addr, const u8 val)
 {
+    // HRAM shares its page with the IO registers
+    if(Util::isAddressBetween(addr, 0xFF80, 0xFFFE))
+    {
+        this->hram[addr - 0xFF80] = val;
+        return;
+    }
+
     if(Util::isAddressBetween(addr, 0x0000, 0x7FFF))
     {
         this->cart.writeByte(addr, val);
+        this->remap();
         return;
     }
 
     if(Util::isAddressBetween(addr, 0x8000, 0x9FFF))
     {
         this->vram[addr - 0x8000] = val;
+
+        if(addr < 0x9800)
+            this->ppu.invalidateTile(addr);
+
         return;
     }
 
+    // Battery RAM takes the slow path until a page is written, from then on until the next flush the page is mapped
     if(Util::isAddressBetween(addr, 0xA000, 0xBFFF))
     {
         this->cart.writeByte(addr, val);
+        this->writePages[addr >> 8] = this->cart.mapRAMWrite(addr & 0xFF00);
         return;
     }
     
-    if(Util::isAddressBetween(addr, 0xC000, 0xDFFF))
+    // WRAM only takes the slow path once the CPU has decoded code from the page
+    if(Util::isAddressBetween(addr, 0xC000, 0xFDFF))
     {
-        this->wram[addr - 0xC000] = val;
-        return;
-    }
+        const u16 offset = (addr - 0xC000) & 0x1FFF;
+        const u8 page = offset >> 8;
 
-    if(Util::isAddressBetween(addr, 0xE000, 0xFDFF))
-    {
-        this->wram[addr - 0xE000] = val;
+        this->wram[offset] = val;
+
+        this->writePages[0xC0 + page] = &this->wram[page << 8];
+        if(0xE0 + page <= 0xFD)
+            this->writePages[0xE0 + page] = &this->wram[page << 8];
+
+        this->cpu.invalidateCodePage(page);
         return;
     }
 
     if(Util::isAddressBetween(addr, 0xFE00, 0xFE9F))
     {
         this->oam[addr - 0xFE00] = val;
-        return;
-    }
-
-    if(Util::isAddressBetween(addr, 0xFF80, 0xFFFE))
-    {
-        this->hram[addr - 0xFF80] = val;
+        this->ppu.invalidateSprites();
         return;
     }
 
@@ -182,25 +276,25 @@ void Bus::writeByte(const u16 addr, const u8 val)
     {
         case 0xFF00:
             this->joypad.joyp = (this->joypad.joyp & 0xF) | (val & 0xF0);
+            this->joypad.checkButtons();
             break;
         case 0xFF04:
-            this->timer.div = 0;
-            this->timer.divCycleCounter = 0;
+            this->timer.writeDIV();
             break;
         case 0xFF05:
-            this->timer.tima = val;
+            this->timer.writeTIMA(val);
             break;
         case 0xFF06:
-            this->timer.tma = val;
+            this->timer.writeTMA(val);
             break;
         case 0xFF07:
-            this->timer.tac = val;
+            this->timer.writeTAC(val);
             break;
         case 0xFF0F:
             this->interrupts.flag = val & 0x1F;
             break;
         case 0xFF40:
-            this->ppu.lcdc = val;
+            this->ppu.writeLCDC(val);
             break;
         case 0xFF41:
             this->ppu.stat = (this->ppu.stat & 0x07) | (val & 0xF8);
@@ -220,6 +314,7 @@ void Bus::writeByte(const u16 addr, const u8 val)
             {
                 this->oam[i] = this->readByte((val << 8) + i);
             }
+            this->ppu.invalidateSprites();
             break;
         case 0xFF47:
             this->ppu.bgp = val;
@@ -232,6 +327,7 @@ void Bus::writeByte(const u16 addr, const u8 val)
             break;
         case 0xFF50:
             this->disableBootRom = true;
+            this->remap();
             break;
         case 0xFF4A:
             this->ppu.wy = val;
@@ -244,19 +340,8 @@ void Bus::writeByte(const u16 addr, const u8 val)
             break;
         default:
             #ifdef ERROR
-                ErrorCollector::reportError(std::format("INVALID_WRITE_ADDRESS {:X}\n", addr), ErrorModule::Bus);
+                this->errors.reportError(std::format("INVALID_WRITE_ADDRESS {:X}\n", addr), ErrorModule::Bus);
             #endif
             break;
     }
-}
-
-u16 Bus::readWord(const u16 addr) const
-{
-    return (this->readByte(addr) | (this->readByte(addr + 1) << 8));
-}
-
-void Bus::writeWord(const u16 addr, const u16 val)
-{
-    this->writeByte(addr, val & 0xFF);
-    this->writeByte(addr + 1, (val & 0xFF00) >> 8);
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "types.h"
+#include "state.h"
+#include "options.h"
 
 class Cart;
 class CPU;
@@ -8,6 +10,7 @@ class Timer;
 class PPU;
 class Joypad;
 class Interrupts;
+class ErrorCollector;
 
 class Bus
 {
@@ -20,6 +23,10 @@ class Bus
 
         bool disableBootRom;
 
+        // Host pointer to each 256-byte page of the address space, nullptr sends the access to the slow path
+        const u8* readPages[0x100];
+        u8* writePages[0x100];
+
         Cart& cart;
         CPU& cpu;
         Timer& timer;
@@ -27,15 +34,62 @@ class Bus
         Joypad& joypad;
         Interrupts& interrupts;
 
+        const Options& options;
+        ErrorCollector& errors;
+
         friend class GameBoy;
+        friend class OpcodeBench;
+        friend class CPU;
+        friend class PPU;
+
+        u8 readSlow(const u16 addr) const;
+        void writeSlow(const u16 addr, const u8 val);
 
     public:
-        Bus(Cart& cart, CPU& cpu, Timer& timer, PPU& ppu, Joypad& joypad, Interrupts& interrupts);
+        Bus(Cart& cart, CPU& cpu, Timer& timer, PPU& ppu, Joypad& joypad, Interrupts& interrupts, const Options& options, ErrorCollector& errors);
 
         void restart();
 
-        u8 readByte(const u16 addr) const;
-        void writeByte(const u16 addr, const u8 val);
-        u16 readWord(const u16 addr) const;
-        void writeWord(const u16 addr, const u16 val);
+        // The cart pages are not remapped on load, that needs the MBC state restored first
+        void saveState(StateWriter& state) const;
+        void loadState(StateReader& state);
+
+        // Rebuild the cart and boot ROM pages, called on ROM load, MBC writes and the boot ROM unmap
+        void remap();
+
+        // Send writes to a WRAM page (and its echo) through the slow path until the next one,
+        // which tells the CPU its decoded blocks from that page are stale
+        void protectCodePage(const u8 page);
+
+        u8 readByte(const u16 addr) const
+        {
+            const u8* page = this->readPages[addr >> 8];
+            if(page)
+                return page[addr & 0xFF];
+
+            return this->readSlow(addr);
+        }
+
+        void writeByte(const u16 addr, const u8 val)
+        {
+            u8* page = this->writePages[addr >> 8];
+            if(page)
+            {
+                page[addr & 0xFF] = val;
+                return;
+            }
+
+            this->writeSlow(addr, val);
+        }
+
+        u16 readWord(const u16 addr) const
+        {
+            return (this->readByte(addr) | (this->readByte(addr + 1) << 8));
+        }
+
+        void writeWord(const u16 addr, const u16 val)
+        {
+            this->writeByte(addr, val & 0xFF);
+            this->writeByte(addr + 1, (val & 0xFF00) >> 8);
+        }
 };
\ No newline at end of file
@@ -4,29 +4,53 @@
     #include "error.h"
 #endif
 
-Cart::Cart()
+Cart::Cart(ErrorCollector& errors) : errors(errors)
 {
     this->restart();
 }
 
 void Cart::restart()
 {
-    this->rom.reset();
-    this->ram.reset();
-    this->mbc.reset();
+    this->image.reset();
+    this->rom = nullptr;
+    this->saveFile.reset();
+    this->ramBuffer.reset();
+    this->ram = nullptr;
+    this->mbc.emplace<ROMOnly>();
+}
+
+void Cart::saveState(StateWriter& state) const
+{
+    state.writeBytes(this->ram, this->ramBanks * 0x2000);
+
+    std::visit([&state](const auto& mbc) { mbc.saveState(state); }, this->mbc);
+}
+
+void Cart::loadState(StateReader& state)
+{
+    const size_t size = this->ramBanks * 0x2000;
+
+    if(!this->saveFile)
+        state.readBytes(this->ram, size);
+    else if(const u8* saved = state.readView(size))
+        this->saveFile->write(saved);
+
+    std::visit([&state](auto& mbc) { mbc.loadState(state); }, this->mbc);
 }
 
 void Cart::createMBC()
 {
+    const CartMemory memory = {this->rom, this->ram, this->romBanks, this->ramBanks};
+
     switch(this->type)
     {
         case Type::ROM_ONLY:
-            return;
+            this->mbc.emplace<ROMOnly>(memory);
             break;
         case Type::MBC1:
         case Type::MBC1_RAM:
         case Type::MBC1_RAM_Battery:
-            this->mbc = std::make_unique<MBC1>(*this);
+            this->mbc.emplace<MBC1>(memory);
             break;
         // case Type::MBC2:
         // case Type::MBC2_Battery:
@@ -40,7 +64,7 @@ void Cart::createMBC()
         case Type::MBC3:
         case Type::MBC3_RAM:
         case Type::MBC3_RAM_BATTERY:
-            this->mbc = std::make_unique<MBC3>(*this);
+            this->mbc.emplace<MBC3>(memory);
             break;
         // case Type::MBC5:
         // case Type::MBC5_RAM:
@@ -55,27 +79,77 @@ void Cart::createMBC()
         // case Type::HuC3:
         // case Type::HuC1_RAM_BATTERY:
         //     break;
+        // GameBoy::loadROM refuses these with isSupported before the cart is touched
         default:
-            #ifdef ERROR
-                ErrorCollector::reportFatalError("UNIMPLEMENTED_MBC", ErrorModule::Cart);
-            #endif
-            exit(EXIT_FAILURE);
+            this->mbc.emplace<ROMOnly>(memory);
             break;
     }
 }
 
-u8 Cart::readByte(const u16 addr) const
+void Cart::createRAM(const std::string& savePath)
 {
-    if(this->type == Type::ROM_ONLY)
-        return this->rom[addr];
-    else
-        return this->mbc.get()->readByte(addr);
+    // The previous ROM's save file is flushed before another one is opened
+    this->saveFile.reset();
+    this->ramBuffer.reset();
+
+    const size_t size = this->ramBanks * 0x2000;
+
+    if(size && this->hasBattery() && !savePath.empty())
+    {
+        this->saveFile = SaveFile::open(savePath, size);
+
+        #ifdef ERROR
+            if(!this->saveFile)
+                this->errors.reportError("COULD_NOT_OPEN_SAVE_FILE", ErrorModule::Cart);
+        #endif
+    }
+
+    if(this->saveFile)
+    {
+        this->ram = this->saveFile->getData();
+        return;
+    }
+
+    this->ramBuffer = std::make_unique<u8[]>(size);
+    this->ram = this->ramBuffer.get();
 }
 
-void Cart::writeByte(const u16 addr, const u8 val)
+bool Cart::isSupported(const u8 type)
 {
-    if(this->type == Type::ROM_ONLY)
-        return;
-    else
-        this->mbc.get()->writeByte(addr, val);
+    switch(static_cast<Type>(type))
+    {
+        case Type::ROM_ONLY:
+        case Type::MBC1:
+        case Type::MBC1_RAM:
+        case Type::MBC1_RAM_Battery:
+        case Type::MBC3_TIMER_BATTERY:
+        case Type::MBC3_TIMER_RAM_BATTERY:
+        case Type::MBC3:
+        case Type::MBC3_RAM:
+        case Type::MBC3_RAM_BATTERY:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool Cart::hasBattery() const
+{
+    switch(this->type)
+    {
+        case Type::MBC1_RAM_Battery:
+        case Type::MBC2_Battery:
+        case Type::ROM_RAM_BETTERY:
+        case Type::MMM01_RAM_BATTERY:
+        case Type::MBC3_TIMER_BATTERY:
+        case Type::MBC3_TIMER_RAM_BATTERY:
+        case Type::MBC3_RAM_BATTERY:
+        case Type::MBC5_RAM_BATTERY:
+        case Type::MBC5_RUMBLE_RAM_BATTERY:
+        case Type::MBC7_SENSOR_RUMBLE_RAM_BATTERY:
+        case Type::HuC1_RAM_BATTERY:
+            return true;
+        default:
+            return false;
+    }
 }
\ No newline at end of file
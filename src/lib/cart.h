@@ -1,9 +1,15 @@
 #pragma once
 
 #include "types.h"
+#include "state.h"
 #include "mbc.h"
+#include "romimage.h"
+#include "savefile.h"
 #include <memory>
 #include <map>
+#include <string>
+
+class ErrorCollector;
 
 class Cart
 {
@@ -67,25 +73,92 @@ class Cart
             {0x05, 8},
         };
 
-        std::unique_ptr<u8[]> rom;
-        std::unique_ptr<u8[]> ram;
+        // Shared with other Carts that loaded the same file, rom points into it
+        std::shared_ptr<const ROMImage> image;
+        const u8* rom;
+        // Points into the save file for battery-backed carts that have one, ramBuffer otherwise
+        u8* ram;
+        std::unique_ptr<u8[]> ramBuffer;
+        std::unique_ptr<SaveFile> saveFile;
 
         Type type;
         u16 romBanks;
         u8 ramBanks;
 
+        ErrorCollector& errors;
+
         friend class GameBoy;
-        friend class MBC1;
+        friend class MBCBench;
+
+        bool hasBattery() const;
+
+        // Whether createMBC has a mapper for the cart type byte at 0x0147
+        static bool isSupported(const u8 type);
 
     public:
-        std::unique_ptr<MBC> mbc;
+        MBC mbc;
 
-        Cart();
+        Cart(ErrorCollector& errors);
 
         void restart();
 
+        // Cart RAM and the MBC registers
+        void saveState(StateWriter& state) const;
+        void loadState(StateReader& state);
+
+        // Needs the ROM and RAM in place, the mapper keeps pointers to them
         void createMBC();
 
-        u8 readByte(const u16 addr) const;
-        void writeByte(const u16 addr, const u8 val);
+        // Allocate the RAM the header declares, backed by savePath if the cart has a battery
+        // and the path isn't empty
+        void createRAM(const std::string& savePath);
+
+        // Defined here so the bus slow path inlines the mapper
+
+        u8 readByte(const u16 addr) const
+        {
+            return std::visit([addr](const auto& mbc) { return mbc.readByte(addr); }, this->mbc);
+        }
+
+        void writeByte(const u16 addr, const u8 val)
+        {
+            std::visit([addr, val](auto& mbc) { mbc.writeByte(addr, val); }, this->mbc);
+
+            // The first write to a clean page of the save file comes through here
+            if(this->saveFile && addr >= 0xA000 && addr <= 0xBFFF)
+            {
+                const u8* byte = this->mapRAM(addr);
+
+                if(byte)
+                    this->saveFile->markDirty(byte - this->ram);
+            }
+        }
+
+        const u8* mapROM(const u16 addr) const
+        {
+            if(!this->rom)
+                return nullptr;
+
+            return std::visit([addr](const auto& mbc) { return mbc.mapROM(addr); }, this->mbc);
+        }
+
+        u8* mapRAM(const u16 addr) const
+        {
+            if(!this->rom)
+                return nullptr;
+
+            return std::visit([addr](const auto& mbc) { return mbc.mapRAM(addr); }, this->mbc);
+        }
+
+        // Like mapRAM, but nullptr for a page of a save file that hasn't been written since its
+        // last flush, so the first write to it goes through writeByte and marks it dirty
+        u8* mapRAMWrite(const u16 addr) const
+        {
+            u8* page = this->mapRAM(addr);
+
+            if(!page || !this->saveFile || this->saveFile->isDirty(page - this->ram))
+                return page;
+
+            return nullptr;
+        }
 };
\ No newline at end of file
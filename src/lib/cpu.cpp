@@ -1,19 +1,52 @@
 #include "cpu.h"
 
+#include <utility>
+#include <string.h>
 #include "gameboy.h"
+#include "opcodes.h"
 
-CPU::CPU(Bus& bus, Interrupts& interrupts) : bus(bus), interrupts(interrupts)
+#ifdef CPU_JIT
+    #include "jit.h"
+#endif
+
+#ifdef ERROR
+    #include <format>
+    #include "error.h"
+#endif
+
+CPU::CPU(Bus& bus, Interrupts& interrupts, Scheduler& scheduler, const Options& options, ErrorCollector& errors) : blocks(CPU::blockCacheSize), bus(bus), interrupts(interrupts), scheduler(scheduler), options(options), errors(errors)
 {
+    memset(this->codeGenerations, 0, sizeof(this->codeGenerations));
+
+    #ifdef CPU_JIT
+        this->jit = std::make_unique<JIT>();
+    #endif
+
     this->restart();
 }
 
+CPU::~CPU()
+{
+
+}
+
 void CPU::restart()
 {
     delayIme = false;
     halted = false;
     haltBug = false;
+    flagState.op = FlagOp::None;
+    idleLoopStats = {0, 0};
+    operand = 0;
+
+    #ifdef CPU_JIT
+        jitStats = {0, 0, 0};
+    #endif
 
-    if(GameBoy::skipBootROM)
+    this->forgetIdleLoop();
+    this->flushBlockCache();
+
+    if(this->options.skipBootROM)
     {
         this->af.hi = 0x01;
         this->af.lo = 0xB0;
@@ -41,12 +74,60 @@ void CPU::restart()
     }
 }
 
+void CPU::saveState(StateWriter& state) const
+{
+    state.write(this->af);
+    state.write(this->bc);
+    state.write(this->de);
+    state.write(this->hl);
+    state.write(this->sp);
+    state.write(this->pc);
+    state.write(this->flagState.op);
+    state.write(this->flagState.lhs);
+    state.write(this->flagState.rhs);
+    state.write(this->flagState.carry);
+    state.write(this->flagState.result);
+    state.write(this->flagState.preserved);
+    state.write(this->operand);
+    state.write(this->delayIme);
+    state.write(this->halted);
+    state.write(this->haltBug);
+}
+
+void CPU::loadState(StateReader& state)
+{
+    state.read(this->af);
+    state.read(this->bc);
+    state.read(this->de);
+    state.read(this->hl);
+    state.read(this->sp);
+    state.read(this->pc);
+    state.read(this->flagState.op);
+    state.read(this->flagState.lhs);
+    state.read(this->flagState.rhs);
+    state.read(this->flagState.carry);
+    state.read(this->flagState.result);
+    state.read(this->flagState.preserved);
+    state.read(this->operand);
+    state.read(this->delayIme);
+    state.read(this->halted);
+    state.read(this->haltBug);
+
+    this->forgetIdleLoop();
+
+    // WRAM contents were replaced, ROM and boot ROM blocks still match what they were decoded from
+    for(u8 page = 0; page < 0x20; ++page)
+        this->invalidateCodePage(page);
+}
+
 // =================================================================================
 // Helper Functions
 // =================================================================================
 
 void CPU::setFlag(Flag flag, const bool val)
 {
+    this->syncFlags();
+
     if(val)    
         this->af.lo |= static_cast<u8>(flag); // Set (1)
     else
@@ -55,9 +136,75 @@ void CPU::setFlag(Flag flag, const bool val)
 
 bool CPU::getFlag(Flag flag) const
 {
+    #ifdef LAZY_FLAGS
+        if(this->flagState.op != FlagOp::None)
+            return (CPU::computeFlags(this->flagState) & static_cast<u8>(flag)) ? true : false;
+    #endif
+
     return (this->af.lo & static_cast<u8>(flag)) ? true : false;
 }
 
+u8 CPU::computeFlags(const FlagState& state)
+{
+    constexpr u8 Z = static_cast<u8>(Flag::Z);
+    constexpr u8 N = static_cast<u8>(Flag::N);
+    constexpr u8 H = static_cast<u8>(Flag::H);
+    constexpr u8 C = static_cast<u8>(Flag::C);
+
+    const u8 zero = static_cast<u8>(state.result) ? 0 : Z;
+
+    switch(state.op)
+    {
+        case FlagOp::Add:
+            return zero | ((((state.lhs & 0xF) + (state.rhs & 0xF) + state.carry) > 0xF) ? H : 0) | ((state.result > 0xFF) ? C : 0);
+        case FlagOp::Sub:
+            return zero | N | (((state.lhs & 0xF) < ((state.rhs & 0xF) + state.carry)) ? H : 0) | ((state.lhs < (state.rhs + state.carry)) ? C : 0);
+        case FlagOp::Inc:
+            return zero | ((state.result & 0xF) ? 0 : H) | state.preserved;
+        case FlagOp::Dec:
+            return zero | N | (((state.result & 0xF) == 0xF) ? H : 0) | state.preserved;
+        case FlagOp::And:
+            return zero | H;
+        case FlagOp::Logic:
+            return zero;
+        case FlagOp::Shift:
+            return zero | (state.carry ? C : 0);
+        case FlagOp::ShiftA:
+            return state.carry ? C : 0;
+        case FlagOp::Bit:
+            return zero | H | state.preserved;
+        default:
+            return 0;
+    }
+}
+
+void CPU::setFlags(const FlagOp op, const u8 lhs, const u8 rhs, const u8 carry, const u16 result)
+{
+    // INC, DEC and BIT leave the carry flag untouched
+    u8 preserved = 0;
+    if(op == FlagOp::Inc || op == FlagOp::Dec || op == FlagOp::Bit)
+        preserved = this->getFlag(Flag::C) ? static_cast<u8>(Flag::C) : 0;
+
+    const FlagState state = {op, lhs, rhs, carry, result, preserved};
+
+    #ifdef LAZY_FLAGS
+        this->flagState = state;
+    #else
+        this->af.lo = CPU::computeFlags(state);
+    #endif
+}
+
+void CPU::syncFlags()
+{
+    #ifdef LAZY_FLAGS
+        if(this->flagState.op == FlagOp::None)
+            return;
+
+        this->af.lo = CPU::computeFlags(this->flagState);
+        this->flagState.op = FlagOp::None;
+    #endif
+}
+
 bool CPU::isConditionTrue(ConditionCode conditionCode) const
 {
     switch(conditionCode)
@@ -80,18 +227,16 @@ bool CPU::isConditionTrue(ConditionCode conditionCode) const
     }
 }
 
+// Operands are read when the instruction is decoded and PC already points past them
+
 u8 CPU::fetchByte()
 {
-    const u8 val = this->bus.readByte(this->pc);
-    ++this->pc;
-    return val;
+    return static_cast<u8>(this->operand);
 }
 
 u16 CPU::fetchWord()
 {
-    const u16 val = this->bus.readWord(this->pc);
-    this->pc += 2;
-    return val;
+    return this->operand;
 }
 
 // =================================================================================
@@ -154,7 +299,10 @@ void CPU::POP(u16& dest)
     dest = val;
 
     if(&dest == &this->af.pair)
+    {
         this->af.pair &= 0xFFF0;
+        this->flagState.op = FlagOp::None;
+    }
 }
 
 // -------- 8-Bit Arithmetic ---------
@@ -162,91 +310,64 @@ void CPU::POP(u16& dest)
 void CPU::ADD(const u8 val, bool carry)
 {
     const u16 sum = this->af.hi + val + carry;
-    this->setFlag(Flag::C, sum > 0xFF);
-    this->setFlag(Flag::H, ((this->af.hi & 0xF) + (val & 0xF) + carry) > 0xF);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::Z, !static_cast<u8>(sum));
+    this->setFlags(FlagOp::Add, this->af.hi, val, carry, sum);
     this->af.hi = static_cast<u8>(sum);
 }
 
 void CPU::SUB(const u8 val, bool carry)
 {
     const u16 difference = this->af.hi - val - carry;
-    this->setFlag(Flag::C, (this->af.hi < (val + carry)));
-    this->setFlag(Flag::H, ((this->af.hi & 0xF) < ((val & 0xF) + carry)));
-    this->setFlag(Flag::N, 1);
-    this->setFlag(Flag::Z, !static_cast<u8>(difference));
+    this->setFlags(FlagOp::Sub, this->af.hi, val, carry, difference);
     this->af.hi = static_cast<u8>(difference);
 }
 
 void CPU::CP(const u8 val)
 {
-    const u8 difference = this->af.hi - val;
-    this->setFlag(Flag::Z, !difference);
-    this->setFlag(Flag::N, 1);
-    this->setFlag(Flag::H, (val & 0xF) > (this->af.hi & 0xF));
-    this->setFlag(Flag::C, val > this->af.hi);
+    this->setFlags(FlagOp::Sub, this->af.hi, val, 0, this->af.hi - val);
 }
 
 void CPU::INC(u8& reg)
 {
     ++reg;
-    this->setFlag(Flag::Z, !reg);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, !(reg & 0xF));
+    this->setFlags(FlagOp::Inc, 0, 0, 0, reg);
 }
 
 void CPU::INCMemoryHL()
 {
-    this->bus.writeByte(this->hl.pair, this->bus.readByte(this->hl.pair) + 1);
-    const u8 result = this->bus.readByte(this->hl.pair);
-    this->setFlag(Flag::Z, !result);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, !(result & 0xF));
+    const u8 result = this->bus.readByte(this->hl.pair) + 1;
+    this->bus.writeByte(this->hl.pair, result);
+    this->setFlags(FlagOp::Inc, 0, 0, 0, result);
 }
 
 void CPU::DEC(u8& reg)
 {
     --reg;
-    this->setFlag(Flag::Z, !reg);
-    this->setFlag(Flag::N, 1);
-    this->setFlag(Flag::H, (reg & 0xF) == 0xF);
+    this->setFlags(FlagOp::Dec, 0, 0, 0, reg);
 }
 
 void CPU::DECMemoryHL()
 {
-    this->bus.writeByte(this->hl.pair, this->bus.readByte(this->hl.pair) - 1);
-    const u8 result = this->bus.readByte(this->hl.pair);
-    this->setFlag(Flag::Z, !result);
-    this->setFlag(Flag::N, 1);
-    this->setFlag(Flag::H, (result & 0xF) == 0xF);
+    const u8 result = this->bus.readByte(this->hl.pair) - 1;
+    this->bus.writeByte(this->hl.pair, result);
+    this->setFlags(FlagOp::Dec, 0, 0, 0, result);
 }
 
 void CPU::AND(const u8 val)
 {
     this->af.hi &= val;
-    this->setFlag(Flag::Z, !this->af.hi);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 1);
-    this->setFlag(Flag::C, 0);
+    this->setFlags(FlagOp::And, 0, 0, 0, this->af.hi);
 }
 
 void CPU::OR(const u8 val)
 {
     this->af.hi |= val;
-    this->setFlag(Flag::Z, !this->af.hi);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
-    this->setFlag(Flag::C, 0);
+    this->setFlags(FlagOp::Logic, 0, 0, 0, this->af.hi);
 }
 
 void CPU::XOR(const u8 val)
 {
     this->af.hi ^= val;
-    this->setFlag(Flag::Z, !this->af.hi);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
-    this->setFlag(Flag::C, 0);
+    this->setFlags(FlagOp::Logic, 0, 0, 0, this->af.hi);
 }
 
 void CPU::CCF()
@@ -331,214 +452,146 @@ void CPU::ADDSPRelative(const i8 offset)
 
 void CPU::RLCA()
 {
-    this->RLC(this->af.hi);
-    this->setFlag(Flag::Z, 0);
+    const u8 carry = this->af.hi >> 7;
+    this->af.hi = (this->af.hi << 1) | carry;
+    this->setFlags(FlagOp::ShiftA, 0, 0, carry, this->af.hi);
 }
 
 void CPU::RRCA()
 {
-    this->RRC(this->af.hi);
-    this->setFlag(Flag::Z, 0);
+    const u8 carry = this->af.hi & 0x1;
+    this->af.hi = (this->af.hi >> 1) | (carry << 7);
+    this->setFlags(FlagOp::ShiftA, 0, 0, carry, this->af.hi);
 }
 
 void CPU::RLA()
 {
-    this->RL(this->af.hi);
-    this->setFlag(Flag::Z, 0);
+    const u8 carry = this->af.hi >> 7;
+    this->af.hi = (this->af.hi << 1) | this->getFlag(Flag::C);
+    this->setFlags(FlagOp::ShiftA, 0, 0, carry, this->af.hi);
 }
 
 void CPU::RRA()
 {
-    this->RR(this->af.hi);
-    this->setFlag(Flag::Z, 0);
+    const u8 carry = this->af.hi & 0x1;
+    this->af.hi = (this->af.hi >> 1) | (this->getFlag(Flag::C) << 7);
+    this->setFlags(FlagOp::ShiftA, 0, 0, carry, this->af.hi);
 }
 
 void CPU::RLC(u8& reg)
 {
-    u8 carry = (reg & 0x80) >> 7;
-    this->setFlag(Flag::C, reg & 0x80);
-    reg <<= 1;
-    reg |= carry;
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
-    this->setFlag(Flag::Z, !reg);
+    const u8 carry = reg >> 7;
+    reg = (reg << 1) | carry;
+    this->setFlags(FlagOp::Shift, 0, 0, carry, reg);
 }
 
 void CPU::RLCMemoryHL()
 {
     u8 temp = this->bus.readByte(this->hl.pair);
-    u8 carry = (temp & 0x80) >> 7;
-    this->setFlag(Flag::C, temp & 0x80);
-    temp <<= 1;
-    temp |= carry;
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
-    this->setFlag(Flag::Z, !temp);
+    this->RLC(temp);
     this->bus.writeByte(this->hl.pair, temp);
 }
 
 void CPU::RRC(u8& reg)
 {
-    u8 carry = (reg & 0x1) << 7;
-    this->setFlag(Flag::C, reg & 0x1);
-    reg >>= 1;
-    reg |= carry;
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
-    this->setFlag(Flag::Z, !reg);
+    const u8 carry = reg & 0x1;
+    reg = (reg >> 1) | (carry << 7);
+    this->setFlags(FlagOp::Shift, 0, 0, carry, reg);
 }
 
 void CPU::RRCMemoryHL()
 {
     u8 temp = this->bus.readByte(this->hl.pair);
-    u8 carry = (temp & 0x1) << 7;
-    this->setFlag(Flag::C, temp & 0x1);
-    temp >>= 1;
-    temp |= carry;
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
-    this->setFlag(Flag::Z, !temp);
+    this->RRC(temp);
     this->bus.writeByte(this->hl.pair, temp);
 }
 
 void CPU::RR(u8& reg)
 {
-    const u8 carry = this->getFlag(Flag::C);
-    this->setFlag(Flag::C, reg & 0x1);
-    reg >>= 1;
-    reg |= (carry << 7);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
-    this->setFlag(Flag::Z, !reg);
+    const u8 carry = reg & 0x1;
+    reg = (reg >> 1) | (this->getFlag(Flag::C) << 7);
+    this->setFlags(FlagOp::Shift, 0, 0, carry, reg);
 }
 
 void CPU::RRMemoryHL()
 {
     u8 temp = this->bus.readByte(this->hl.pair);
-    const u8 carry = this->getFlag(Flag::C);
-    this->setFlag(Flag::C, temp & 0x1);
-    temp >>= 1;
-    temp |= (carry << 7);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
-    this->setFlag(Flag::Z, !temp);
+    this->RR(temp);
     this->bus.writeByte(this->hl.pair, temp);
 }
 
 void CPU::RL(u8& reg)
 {
-    bool oldCarry = this->getFlag(Flag::C);
-    this->setFlag(Flag::C, reg & 0x80);
-    reg <<= 1;
-    reg |= oldCarry;
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
-    this->setFlag(Flag::Z, !reg);
+    const u8 carry = reg >> 7;
+    reg = (reg << 1) | this->getFlag(Flag::C);
+    this->setFlags(FlagOp::Shift, 0, 0, carry, reg);
 }
+
 void CPU::RLMemoryHL()
 {
     u8 temp = this->bus.readByte(this->hl.pair);
-    bool oldCarry = this->getFlag(Flag::C);
-    this->setFlag(Flag::C, temp & 0x80);
-    temp <<= 1;
-    temp |= oldCarry;
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
-    this->setFlag(Flag::Z, !temp);
+    this->RL(temp);
     this->bus.writeByte(this->hl.pair, temp);
 }
 
 void CPU::SLA(u8& reg)
 {
-    this->setFlag(Flag::C, reg & 0x80);
+    const u8 carry = reg >> 7;
     reg <<= 1;
-    this->setFlag(Flag::Z, !reg);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
+    this->setFlags(FlagOp::Shift, 0, 0, carry, reg);
 }
 
 void CPU::SLAMemoryHL()
 {
     u8 temp = this->bus.readByte(this->hl.pair);
-    this->setFlag(Flag::C, temp & 0x80);
-    temp <<= 1;
-    this->setFlag(Flag::Z, !temp);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
+    this->SLA(temp);
     this->bus.writeByte(this->hl.pair, temp);
 }
 
 void CPU::SRA(u8& reg)
 {
-    this->setFlag(Flag::C, reg & 0x1);
-    const u8 msb = reg & (1 << 7);
-    reg >>= 1;
-    reg |= msb;
-    this->setFlag(Flag::Z, !reg);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
+    const u8 carry = reg & 0x1;
+    reg = (reg >> 1) | (reg & 0x80);
+    this->setFlags(FlagOp::Shift, 0, 0, carry, reg);
 }
 
 void CPU::SRAMemoryHL()
 {
     u8 temp = this->bus.readByte(this->hl.pair);
-    this->setFlag(Flag::C, temp & 0x1);
-    const u8 msb = temp & (1 << 7);
-    temp >>= 1;
-    temp |= msb;
-    this->setFlag(Flag::Z, !temp);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
+    this->SRA(temp);
     this->bus.writeByte(this->hl.pair, temp);
 }
 
 void CPU::SWAP(u8& reg)
 {
-    const u8 lower = reg << 4;
-    reg = (reg >> 4) | lower;
-    this->setFlag(Flag::Z, !reg);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
-    this->setFlag(Flag::C, 0);
+    reg = (reg >> 4) | (reg << 4);
+    this->setFlags(FlagOp::Logic, 0, 0, 0, reg);
 }
 
 void CPU::SWAPMemoryHL()
 {
     u8 temp = this->bus.readByte(this->hl.pair);
-    const u8 lower = temp << 4;
-    temp = (temp >> 4) | lower;
-    this->setFlag(Flag::Z, !temp);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
-    this->setFlag(Flag::C, 0);
+    this->SWAP(temp);
     this->bus.writeByte(this->hl.pair, temp);
 }
 
 void CPU::SRL(u8& reg)
 {
-    this->setFlag(Flag::C, reg & 0x1);
+    const u8 carry = reg & 0x1;
     reg >>= 1;
-    this->setFlag(Flag::Z, !reg);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
+    this->setFlags(FlagOp::Shift, 0, 0, carry, reg);
 }
 
 void CPU::SRLMemoryHL()
 {
     u8 temp = this->bus.readByte(this->hl.pair);
-    this->setFlag(Flag::C, temp & 0x1);
-    temp >>= 1;
-    this->setFlag(Flag::Z, !temp);
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 0);
+    this->SRL(temp);
     this->bus.writeByte(this->hl.pair, temp);
 }
 
 void CPU::BIT(const u8 bit, const u8 val)
 {
-    this->setFlag(Flag::Z, !(val & bit));
-    this->setFlag(Flag::N, 0);
-    this->setFlag(Flag::H, 1);
+    this->setFlags(FlagOp::Bit, 0, 0, 0, val & bit);
 }
 
 void CPU::RES(const u8 bit, u8& reg)
@@ -563,36 +616,49 @@ void CPU::SETMemoryHL(const u8 bit)
 
 // -------- Control Flow -------------
 
-void CPU::JP(const u16 addr, ConditionCode conditionCode)
+bool CPU::JP(const u16 addr, ConditionCode conditionCode)
 {
-    if(this->isConditionTrue(conditionCode))
-        this->pc = addr;
+    if(!this->isConditionTrue(conditionCode))
+        return false;
+
+    this->pc = addr;
+    return true;
 }
 
-void CPU::JR(const i8 offset, ConditionCode conditionCode)
+bool CPU::JR(const i8 offset, ConditionCode conditionCode)
 {
-    if(this->isConditionTrue(conditionCode))
-        this->pc += offset;
+    if(!this->isConditionTrue(conditionCode))
+        return false;
+
+    this->pc += offset;
+
+    if(offset < 0 && this->options.idleLoopDetection)
+        this->checkIdleLoop(this->pc - offset - 2);
+
+    return true;
 }
 
-void CPU::CALL(const u16 addr, ConditionCode conditionCode)
+bool CPU::CALL(const u16 addr, ConditionCode conditionCode)
 {
-    if(this->isConditionTrue(conditionCode))
-    {
-        this->PUSH(this->pc);
-        this->pc = addr;
-    }
+    if(!this->isConditionTrue(conditionCode))
+        return false;
+
+    this->PUSH(this->pc);
+    this->pc = addr;
+    return true;
 }
 
-void CPU::RET(ConditionCode conditionCode, bool fromInterruptHandler)
+bool CPU::RET(ConditionCode conditionCode, bool fromInterruptHandler)
 {
-    if(this->isConditionTrue(conditionCode))
-    {
-        this->POP(this->pc);
+    if(!this->isConditionTrue(conditionCode))
+        return false;
 
-        if(fromInterruptHandler)
-            this->delayIme = true;
-    }
+    this->POP(this->pc);
+
+    if(fromInterruptHandler)
+        this->delayIme = true;
+
+    return true;
 }
 
 void CPU::RST(const u16 vec)
@@ -618,7 +684,8 @@ void CPU::HALT()
 
 void CPU::STOP()
 {
-
+    // STOP is followed by a padding byte
+    this->fetchByte();
 }
 
 void CPU::DI()
@@ -636,529 +703,1150 @@ void CPU::EI()
 // Opcodes
 // =================================================================================
 
-u8 CPU::executeOpcode(const u8 opcode)
+// Every dispatch engine calls these with a constant opcode, so the switch folds away
+// to a single case and each generated handler is just that instruction's body
+
+[[gnu::always_inline]] inline u8 CPU::execute(const u8 opcode)
 {
-    if(this->delayIme)
+    bool branch = false;
+
+    switch(opcode)
     {
-        this->interrupts.ime = true;
-        this->delayIme = false;
+        case 0x00: break;
+        case 0x01: this->LD(this->bc.pair, this->fetchWord()); break;
+        case 0x02: this->LDMemory(this->bc.pair, this->af.hi); break;
+        case 0x03: this->INC(this->bc.pair); break;
+        case 0x04: this->INC(this->bc.hi); break;
+        case 0x05: this->DEC(this->bc.hi); break;
+        case 0x06: this->LD(this->bc.hi, this->fetchByte()); break;
+        case 0x07: this->RLCA(); break;
+        case 0x08: this->LDMemory(this->fetchWord(), this->sp); break;
+        case 0x09: this->ADDHL(this->bc.pair); break;
+        case 0x0A: this->LD(this->af.hi, this->bus.readByte(this->bc.pair)); break;
+        case 0x0B: this->DEC(this->bc.pair); break;
+        case 0x0C: this->INC(this->bc.lo); break;
+        case 0x0D: this->DEC(this->bc.lo); break;
+        case 0x0E: this->LD(this->bc.lo, this->fetchByte()); break;
+        case 0x0F: this->RRCA(); break;
+        case 0x10: this->STOP(); break;
+        case 0x11: this->LD(this->de.pair, this->fetchWord()); break;
+        case 0x12: this->LDMemory(this->de.pair, this->af.hi); break;
+        case 0x13: this->INC(this->de.pair); break;
+        case 0x14: this->INC(this->de.hi); break;
+        case 0x15: this->DEC(this->de.hi); break;
+        case 0x16: this->LD(this->de.hi, this->fetchByte()); break;
+        case 0x17: this->RLA(); break;
+        case 0x18: this->JR(this->fetchByte(), ConditionCode::None); break;
+        case 0x19: this->ADDHL(this->de.pair); break;
+        case 0x1A: this->LD(this->af.hi, this->bus.readByte(this->de.pair)); break;
+        case 0x1B: this->DEC(this->de.pair); break;
+        case 0x1C: this->INC(this->de.lo); break;
+        case 0x1D: this->DEC(this->de.lo); break;
+        case 0x1E: this->LD(this->de.lo, this->fetchByte()); break;
+        case 0x1F: this->RRA(); break;
+        case 0x20: branch = this->JR(this->fetchByte(), ConditionCode::NZ); break;
+        case 0x21: this->LD(this->hl.pair, this->fetchWord()); break;
+        case 0x22: this->LDMemory(this->hl.pair++, this->af.hi); break;
+        case 0x23: this->INC(this->hl.pair); break;
+        case 0x24: this->INC(this->hl.hi); break;
+        case 0x25: this->DEC(this->hl.hi); break;
+        case 0x26: this->LD(this->hl.hi, this->fetchByte()); break;
+        case 0x27: this->DAA(); break;
+        case 0x28: branch = this->JR(this->fetchByte(), ConditionCode::Z); break;
+        case 0x29: this->ADDHL(this->hl.pair); break;
+        case 0x2A: this->LD(this->af.hi, this->bus.readByte(this->hl.pair++)); break;
+        case 0x2B: this->DEC(this->hl.pair); break;
+        case 0x2C: this->INC(this->hl.lo); break;
+        case 0x2D: this->DEC(this->hl.lo); break;
+        case 0x2E: this->LD(this->hl.lo, this->fetchByte()); break;
+        case 0x2F: this->CPL(); break;
+        case 0x30: branch = this->JR(this->fetchByte(), ConditionCode::NC); break;
+        case 0x31: this->LD(this->sp, this->fetchWord()); break;
+        case 0x32: this->LDMemory(this->hl.pair--, this->af.hi); break;
+        case 0x33: this->INC(this->sp); break;
+        case 0x34: this->INCMemoryHL(); break;
+        case 0x35: this->DECMemoryHL(); break;
+        case 0x36: this->LDMemory(this->hl.pair, this->fetchByte()); break;
+        case 0x37: this->SCF(); break;
+        case 0x38: branch = this->JR(this->fetchByte(), ConditionCode::C); break;
+        case 0x39: this->ADDHL(this->sp); break;
+        case 0x3A: this->LD(this->af.hi, this->bus.readByte(this->hl.pair--)); break;
+        case 0x3B: this->DEC(this->sp); break;
+        case 0x3C: this->INC(this->af.hi); break;
+        case 0x3D: this->DEC(this->af.hi); break;
+        case 0x3E: this->LD(this->af.hi, this->fetchByte()); break;
+        case 0x3F: this->CCF(); break;
+        case 0x40: this->LD(this->bc.hi, this->bc.hi); break;
+        case 0x41: this->LD(this->bc.hi, this->bc.lo); break;
+        case 0x42: this->LD(this->bc.hi, this->de.hi); break;
+        case 0x43: this->LD(this->bc.hi, this->de.lo); break;
+        case 0x44: this->LD(this->bc.hi, this->hl.hi); break;
+        case 0x45: this->LD(this->bc.hi, this->hl.lo); break;
+        case 0x46: this->LD(this->bc.hi, this->bus.readByte(this->hl.pair)); break;
+        case 0x47: this->LD(this->bc.hi, this->af.hi); break;
+        case 0x48: this->LD(this->bc.lo, this->bc.hi); break;
+        case 0x49: this->LD(this->bc.lo, this->bc.lo); break;
+        case 0x4A: this->LD(this->bc.lo, this->de.hi); break;
+        case 0x4B: this->LD(this->bc.lo, this->de.lo); break;
+        case 0x4C: this->LD(this->bc.lo, this->hl.hi); break;
+        case 0x4D: this->LD(this->bc.lo, this->hl.lo); break;
+        case 0x4E: this->LD(this->bc.lo, this->bus.readByte(this->hl.pair)); break;
+        case 0x4F: this->LD(this->bc.lo, this->af.hi); break;
+        case 0x50: this->LD(this->de.hi, this->bc.hi); break;
+        case 0x51: this->LD(this->de.hi, this->bc.lo); break;
+        case 0x52: this->LD(this->de.hi, this->de.hi); break;
+        case 0x53: this->LD(this->de.hi, this->de.lo); break;
+        case 0x54: this->LD(this->de.hi, this->hl.hi); break;
+        case 0x55: this->LD(this->de.hi, this->hl.lo); break;
+        case 0x56: this->LD(this->de.hi, this->bus.readByte(this->hl.pair)); break;
+        case 0x57: this->LD(this->de.hi, this->af.hi); break;
+        case 0x58: this->LD(this->de.lo, this->bc.hi); break;
+        case 0x59: this->LD(this->de.lo, this->bc.lo); break;
+        case 0x5A: this->LD(this->de.lo, this->de.hi); break;
+        case 0x5B: this->LD(this->de.lo, this->de.lo); break;
+        case 0x5C: this->LD(this->de.lo, this->hl.hi); break;
+        case 0x5D: this->LD(this->de.lo, this->hl.lo); break;
+        case 0x5E: this->LD(this->de.lo, this->bus.readByte(this->hl.pair)); break;
+        case 0x5F: this->LD(this->de.lo, this->af.hi); break;
+        case 0x60: this->LD(this->hl.hi, this->bc.hi); break;
+        case 0x61: this->LD(this->hl.hi, this->bc.lo); break;
+        case 0x62: this->LD(this->hl.hi, this->de.hi); break;
+        case 0x63: this->LD(this->hl.hi, this->de.lo); break;
+        case 0x64: this->LD(this->hl.hi, this->hl.hi); break;
+        case 0x65: this->LD(this->hl.hi, this->hl.lo); break;
+        case 0x66: this->LD(this->hl.hi, this->bus.readByte(this->hl.pair)); break;
+        case 0x67: this->LD(this->hl.hi, this->af.hi); break;
+        case 0x68: this->LD(this->hl.lo, this->bc.hi); break;
+        case 0x69: this->LD(this->hl.lo, this->bc.lo); break;
+        case 0x6A: this->LD(this->hl.lo, this->de.hi); break;
+        case 0x6B: this->LD(this->hl.lo, this->de.lo); break;
+        case 0x6C: this->LD(this->hl.lo, this->hl.hi); break;
+        case 0x6D: this->LD(this->hl.lo, this->hl.lo); break;
+        case 0x6E: this->LD(this->hl.lo, this->bus.readByte(this->hl.pair)); break;
+        case 0x6F: this->LD(this->hl.lo, this->af.hi); break;
+        case 0x70: this->LDMemory(this->hl.pair, this->bc.hi); break;
+        case 0x71: this->LDMemory(this->hl.pair, this->bc.lo); break;
+        case 0x72: this->LDMemory(this->hl.pair, this->de.hi); break;
+        case 0x73: this->LDMemory(this->hl.pair, this->de.lo); break;
+        case 0x74: this->LDMemory(this->hl.pair, this->hl.hi); break;
+        case 0x75: this->LDMemory(this->hl.pair, this->hl.lo); break;
+        case 0x76: this->HALT(); break;
+        case 0x77: this->LDMemory(this->hl.pair, this->af.hi); break;
+        case 0x78: this->LD(this->af.hi, this->bc.hi); break;
+        case 0x79: this->LD(this->af.hi, this->bc.lo); break;
+        case 0x7A: this->LD(this->af.hi, this->de.hi); break;
+        case 0x7B: this->LD(this->af.hi, this->de.lo); break;
+        case 0x7C: this->LD(this->af.hi, this->hl.hi); break;
+        case 0x7D: this->LD(this->af.hi, this->hl.lo); break;
+        case 0x7E: this->LD(this->af.hi, this->bus.readByte(this->hl.pair)); break;
+        case 0x7F: this->LD(this->af.hi, this->af.hi); break;
+        case 0x80: this->ADD(this->bc.hi, false); break;
+        case 0x81: this->ADD(this->bc.lo, false); break;
+        case 0x82: this->ADD(this->de.hi, false); break;
+        case 0x83: this->ADD(this->de.lo, false); break;
+        case 0x84: this->ADD(this->hl.hi, false); break;
+        case 0x85: this->ADD(this->hl.lo, false); break;
+        case 0x86: this->ADD(this->bus.readByte(this->hl.pair), false); break;
+        case 0x87: this->ADD(this->af.hi, false); break;
+        case 0x88: this->ADD(this->bc.hi, this->getFlag(Flag::C)); break;
+        case 0x89: this->ADD(this->bc.lo, this->getFlag(Flag::C)); break;
+        case 0x8A: this->ADD(this->de.hi, this->getFlag(Flag::C)); break;
+        case 0x8B: this->ADD(this->de.lo, this->getFlag(Flag::C)); break;
+        case 0x8C: this->ADD(this->hl.hi, this->getFlag(Flag::C)); break;
+        case 0x8D: this->ADD(this->hl.lo, this->getFlag(Flag::C)); break;
+        case 0x8E: this->ADD(this->bus.readByte(this->hl.pair), this->getFlag(Flag::C)); break;
+        case 0x8F: this->ADD(this->af.hi, this->getFlag(Flag::C)); break;
+        case 0x90: this->SUB(this->bc.hi, false); break;
+        case 0x91: this->SUB(this->bc.lo, false); break;
+        case 0x92: this->SUB(this->de.hi, false); break;
+        case 0x93: this->SUB(this->de.lo, false); break;
+        case 0x94: this->SUB(this->hl.hi, false); break;
+        case 0x95: this->SUB(this->hl.lo, false); break;
+        case 0x96: this->SUB(this->bus.readByte(this->hl.pair), false); break;
+        case 0x97: this->SUB(this->af.hi, false); break;
+        case 0x98: this->SUB(this->bc.hi, this->getFlag(Flag::C)); break;
+        case 0x99: this->SUB(this->bc.lo, this->getFlag(Flag::C)); break;
+        case 0x9A: this->SUB(this->de.hi, this->getFlag(Flag::C)); break;
+        case 0x9B: this->SUB(this->de.lo, this->getFlag(Flag::C)); break;
+        case 0x9C: this->SUB(this->hl.hi, this->getFlag(Flag::C)); break;
+        case 0x9D: this->SUB(this->hl.lo, this->getFlag(Flag::C)); break;
+        case 0x9E: this->SUB(this->bus.readByte(this->hl.pair), this->getFlag(Flag::C)); break;
+        case 0x9F: this->SUB(this->af.hi, this->getFlag(Flag::C)); break;
+        case 0xA0: this->AND(this->bc.hi); break;
+        case 0xA1: this->AND(this->bc.lo); break;
+        case 0xA2: this->AND(this->de.hi); break;
+        case 0xA3: this->AND(this->de.lo); break;
+        case 0xA4: this->AND(this->hl.hi); break;
+        case 0xA5: this->AND(this->hl.lo); break;
+        case 0xA6: this->AND(this->bus.readByte(this->hl.pair)); break;
+        case 0xA7: this->AND(this->af.hi); break;
+        case 0xA8: this->XOR(this->bc.hi); break;
+        case 0xA9: this->XOR(this->bc.lo); break;
+        case 0xAA: this->XOR(this->de.hi); break;
+        case 0xAB: this->XOR(this->de.lo); break;
+        case 0xAC: this->XOR(this->hl.hi); break;
+        case 0xAD: this->XOR(this->hl.lo); break;
+        case 0xAE: this->XOR(this->bus.readByte(this->hl.pair)); break;
+        case 0xAF: this->XOR(this->af.hi); break;
+        case 0xB0: this->OR(this->bc.hi); break;
+        case 0xB1: this->OR(this->bc.lo); break;
+        case 0xB2: this->OR(this->de.hi); break;
+        case 0xB3: this->OR(this->de.lo); break;
+        case 0xB4: this->OR(this->hl.hi); break;
+        case 0xB5: this->OR(this->hl.lo); break;
+        case 0xB6: this->OR(this->bus.readByte(this->hl.pair)); break;
+        case 0xB7: this->OR(this->af.hi); break;
+        case 0xB8: this->CP(this->bc.hi); break;
+        case 0xB9: this->CP(this->bc.lo); break;
+        case 0xBA: this->CP(this->de.hi); break;
+        case 0xBB: this->CP(this->de.lo); break;
+        case 0xBC: this->CP(this->hl.hi); break;
+        case 0xBD: this->CP(this->hl.lo); break;
+        case 0xBE: this->CP(this->bus.readByte(this->hl.pair)); break;
+        case 0xBF: this->CP(this->af.hi); break;
+        case 0xC0: branch = this->RET(ConditionCode::NZ, false); break;
+        case 0xC1: this->POP(this->bc.pair); break;
+        case 0xC2: branch = this->JP(this->fetchWord(), ConditionCode::NZ); break;
+        case 0xC3: this->JP(this->fetchWord(), ConditionCode::None); break;
+        case 0xC4: branch = this->CALL(this->fetchWord(), ConditionCode::NZ); break;
+        case 0xC5: this->PUSH(this->bc.pair); break;
+        case 0xC6: this->ADD(this->fetchByte(), false); break;
+        case 0xC7: this->RST(0x00); break;
+        case 0xC8: branch = this->RET(ConditionCode::Z, false); break;
+        case 0xC9: this->RET(ConditionCode::None, false); break;
+        case 0xCA: branch = this->JP(this->fetchWord(), ConditionCode::Z); break;
+        case 0xCB: return this->executeExtendedOpcode(this->fetchByte());
+        case 0xCC: branch = this->CALL(this->fetchWord(), ConditionCode::Z); break;
+        case 0xCD: this->CALL(this->fetchWord(), ConditionCode::None); break;
+        case 0xCE: this->ADD(this->fetchByte(), this->getFlag(Flag::C)); break;
+        case 0xCF: this->RST(0x08); break;
+        case 0xD0: branch = this->RET(ConditionCode::NC, false); break;
+        case 0xD1: this->POP(this->de.pair); break;
+        case 0xD2: branch = this->JP(this->fetchWord(), ConditionCode::NC); break;
+        case 0xD4: branch = this->CALL(this->fetchWord(), ConditionCode::NC); break;
+        case 0xD5: this->PUSH(this->de.pair); break;
+        case 0xD6: this->SUB(this->fetchByte(), false); break;
+        case 0xD7: this->RST(0x10); break;
+        case 0xD8: branch = this->RET(ConditionCode::C, false); break;
+        case 0xD9: this->RET(ConditionCode::None, true); break;
+        case 0xDA: branch = this->JP(this->fetchWord(), ConditionCode::C); break;
+        case 0xDC: branch = this->CALL(this->fetchWord(), ConditionCode::C); break;
+        case 0xDE: this->SUB(this->fetchByte(), this->getFlag(Flag::C)); break;
+        case 0xDF: this->RST(0x18); break;
+        case 0xE0: this->LDHMemory(this->fetchByte()); break;
+        case 0xE1: this->POP(this->hl.pair); break;
+        case 0xE2: this->LDHMemory(this->bc.lo); break;
+        case 0xE5: this->PUSH(this->hl.pair); break;
+        case 0xE6: this->AND(this->fetchByte()); break;
+        case 0xE7: this->RST(0x20); break;
+        case 0xE8: this->ADDSPRelative(this->fetchByte()); break;
+        case 0xE9: this->JP(this->hl.pair, ConditionCode::None); break;
+        case 0xEA: this->LDMemory(this->fetchWord(), this->af.hi); break;
+        case 0xEE: this->XOR(this->fetchByte()); break;
+        case 0xEF: this->RST(0x28); break;
+        case 0xF0: this->LDH(this->fetchByte()); break;
+        case 0xF1: this->POP(this->af.pair); break;
+        case 0xF2: this->LD(this->af.hi, this->bus.readByte(0xFF00 + this->bc.lo)); break;
+        case 0xF3: this->DI(); break;
+        case 0xF5: this->syncFlags(); this->PUSH(this->af.pair); break;
+        case 0xF6: this->OR(this->fetchByte()); break;
+        case 0xF7: this->RST(0x30); break;
+        case 0xF8: this->LDHLAdjustedSP(this->fetchByte()); break;
+        case 0xF9: this->LD(this->sp, this->hl.pair); break;
+        case 0xFA: this->LD(this->af.hi, this->bus.readByte(this->fetchWord())); break;
+        case 0xFB: this->EI(); break;
+        case 0xFE: this->CP(this->fetchByte()); break;
+        case 0xFF: this->RST(0x38); break;
+        default: break;
     }
 
+    return branch ? Opcodes::base[opcode].branchCycles : Opcodes::base[opcode].cycles;
+}
+
+[[gnu::always_inline]] inline u8 CPU::executeExtended(const u8 opcode)
+{
     switch(opcode)
     {
-        case 0x00: return 4; break;
-        case 0x01: this->LD(this->bc.pair, this->fetchWord()); return 12; break;
-        case 0x02: this->LDMemory(this->bc.pair, this->af.hi); return 8; break;
-        case 0x03: this->INC(this->bc.pair); return 8; break;
-        case 0x04: this->INC(this->bc.hi); return 4; break;
-        case 0x05: this->DEC(this->bc.hi); return 4; break;
-        case 0x06: this->LD(this->bc.hi, this->fetchByte()); return 8; break;
-        case 0x07: this->RLCA(); return 4; break;
-        case 0x08: this->LDMemory(this->fetchWord(), this->sp); return 20; break;
-        case 0x09: this->ADDHL(this->bc.pair); return 8; break;
-        case 0x0A: this->LD(this->af.hi, this->bus.readByte(this->bc.pair)); return 8; break;
-        case 0x0B: this->DEC(this->bc.pair); return 8; break;
-        case 0x0C: this->INC(this->bc.lo); return 4; break;
-        case 0x0D: this->DEC(this->bc.lo); return 4; break;
-        case 0x0E: this->LD(this->bc.lo, this->fetchByte()); return 8; break;
-        case 0x0F: this->RRCA(); return 4; break;
-        case 0x10: this->STOP(); return 4; break;
-        case 0x11: this->LD(this->de.pair, this->fetchWord()); return 12; break;
-        case 0x12: this->LDMemory(this->de.pair, this->af.hi); return 8; break;
-        case 0x13: this->INC(this->de.pair); return 8; break;
-        case 0x14: this->INC(this->de.hi); return 4; break;
-        case 0x15: this->DEC(this->de.hi); return 4; break;
-        case 0x16: this->LD(this->de.hi, this->fetchByte()); return 8; break;
-        case 0x17: this->RLA(); return 4; break;
-        case 0x18: this->JR(this->fetchByte(), ConditionCode::None); return 12; break;
-        case 0x19: this->ADDHL(this->de.pair); return 8; break;
-        case 0x1A: this->LD(this->af.hi, this->bus.readByte(this->de.pair)); return 8; break;
-        case 0x1B: this->DEC(this->de.pair); return 8; break;
-        case 0x1C: this->INC(this->de.lo); return 4; break;
-        case 0x1D: this->DEC(this->de.lo); return 4; break;
-        case 0x1E: this->LD(this->de.lo, this->fetchByte()); return 8; break;
-        case 0x1F: this->RRA(); return 4; break;
-        case 0x20: this->JR(this->fetchByte(), ConditionCode::NZ); return 12; break;
-        case 0x21: this->LD(this->hl.pair, this->fetchWord()); return 12; break;
-        case 0x22: this->LDMemory(this->hl.pair++, this->af.hi); return 8; break;
-        case 0x23: this->INC(this->hl.pair); return 8; break;
-        case 0x24: this->INC(this->hl.hi); return 4; break;
-        case 0x25: this->DEC(this->hl.hi); return 4; break;
-        case 0x26: this->LD(this->hl.hi, this->fetchByte()); return 8; break;
-        case 0x27: this->DAA(); return 4; break;
-        case 0x28: this->JR(this->fetchByte(), ConditionCode::Z); return 12; break;
-        case 0x29: this->ADDHL(this->hl.pair); return 8; break;
-        case 0x2A: this->LD(this->af.hi, this->bus.readByte(this->hl.pair++)); return 8; break;
-        case 0x2B: this->DEC(this->hl.pair); return 8; break;
-        case 0x2C: this->INC(this->hl.lo); return 4; break;
-        case 0x2D: this->DEC(this->hl.lo); return 4; break;
-        case 0x2E: this->LD(this->hl.lo, this->fetchByte()); return 8; break;
-        case 0x2F: this->CPL(); return 4; break;
-        case 0x30: this->JR(this->fetchByte(), ConditionCode::NC); return 12; break;
-        case 0x31: this->LD(this->sp, this->fetchWord()); return 12; break;
-        case 0x32: this->LDMemory(this->hl.pair--, this->af.hi); return 8; break;
-        case 0x33: this->INC(this->sp); return 8; break;
-        case 0x34: this->INCMemoryHL(); return 12; break;
-        case 0x35: this->DECMemoryHL(); return 12; break;
-        case 0x36: this->LDMemory(this->hl.pair, this->fetchByte()); return 12; break;
-        case 0x37: this->SCF(); return 4; break;
-        case 0x38: this->JR(this->fetchByte(), ConditionCode::C); return 12; break;
-        case 0x39: this->ADDHL(this->sp); return 8; break;
-        case 0x3A: this->LD(this->af.hi, this->bus.readByte(this->hl.pair--)); return 8; break;
-        case 0x3B: this->DEC(this->sp); return 8; break;
-        case 0x3C: this->INC(this->af.hi); return 4; break;
-        case 0x3D: this->DEC(this->af.hi); return 4; break;
-        case 0x3E: this->LD(this->af.hi, this->fetchByte()); return 8; break;
-        case 0x3F: this->CCF(); return 4; break;
-        case 0x40: this->LD(this->bc.hi, this->bc.hi); return 4; break;
-        case 0x41: this->LD(this->bc.hi, this->bc.lo); return 4; break;
-        case 0x42: this->LD(this->bc.hi, this->de.hi); return 4; break;
-        case 0x43: this->LD(this->bc.hi, this->de.lo); return 4; break;
-        case 0x44: this->LD(this->bc.hi, this->hl.hi); return 4; break;
-        case 0x45: this->LD(this->bc.hi, this->hl.lo); return 4; break;
-        case 0x46: this->LD(this->bc.hi, this->bus.readByte(this->hl.pair)); return 8; break;
-        case 0x47: this->LD(this->bc.hi, this->af.hi); return 4; break;
-        case 0x48: this->LD(this->bc.lo, this->bc.hi); return 4; break;
-        case 0x49: this->LD(this->bc.lo, this->bc.lo); return 4; break;
-        case 0x4A: this->LD(this->bc.lo, this->de.hi); return 4; break;
-        case 0x4B: this->LD(this->bc.lo, this->de.lo); return 4; break;
-        case 0x4C: this->LD(this->bc.lo, this->hl.hi); return 4; break;
-        case 0x4D: this->LD(this->bc.lo, this->hl.lo); return 4; break;
-        case 0x4E: this->LD(this->bc.lo, this->bus.readByte(this->hl.pair)); return 8; break;
-        case 0x4F: this->LD(this->bc.lo, this->af.hi); return 4; break;
-        case 0x50: this->LD(this->de.hi, this->bc.hi); return 4; break;
-        case 0x51: this->LD(this->de.hi, this->bc.lo); return 4; break;
-        case 0x52: this->LD(this->de.hi, this->de.hi); return 4; break;
-        case 0x53: this->LD(this->de.hi, this->de.lo); return 4; break;
-        case 0x54: this->LD(this->de.hi, this->hl.hi); return 4; break;
-        case 0x55: this->LD(this->de.hi, this->hl.lo); return 4; break;
-        case 0x56: this->LD(this->de.hi, this->bus.readByte(this->hl.pair)); return 8; break;
-        case 0x57: this->LD(this->de.hi, this->af.hi); return 4; break;
-        case 0x58: this->LD(this->de.lo, this->bc.hi); return 4; break;
-        case 0x59: this->LD(this->de.lo, this->bc.lo); return 4; break;
-        case 0x5A: this->LD(this->de.lo, this->de.hi); return 4; break;
-        case 0x5B: this->LD(this->de.lo, this->de.lo); return 4; break;
-        case 0x5C: this->LD(this->de.lo, this->hl.hi); return 4; break;
-        case 0x5D: this->LD(this->de.lo, this->hl.lo); return 4; break;
-        case 0x5E: this->LD(this->de.lo, this->bus.readByte(this->hl.pair)); return 8; break;
-        case 0x5F: this->LD(this->de.lo, this->af.hi); return 4; break;
-        case 0x60: this->LD(this->hl.hi, this->bc.hi); return 4; break;
-        case 0x61: this->LD(this->hl.hi, this->bc.lo); return 4; break;
-        case 0x62: this->LD(this->hl.hi, this->de.hi); return 4; break;
-        case 0x63: this->LD(this->hl.hi, this->de.lo); return 4; break;
-        case 0x64: this->LD(this->hl.hi, this->hl.hi); return 4; break;
-        case 0x65: this->LD(this->hl.hi, this->hl.lo); return 4; break;
-        case 0x66: this->LD(this->hl.hi, this->bus.readByte(this->hl.pair)); return 8; break;
-        case 0x67: this->LD(this->hl.hi, this->af.hi); return 4; break;
-        case 0x68: this->LD(this->hl.lo, this->bc.hi); return 4; break;
-        case 0x69: this->LD(this->hl.lo, this->bc.lo); return 4; break;
-        case 0x6A: this->LD(this->hl.lo, this->de.hi); return 4; break;
-        case 0x6B: this->LD(this->hl.lo, this->de.lo); return 4; break;
-        case 0x6C: this->LD(this->hl.lo, this->hl.hi); return 4; break;
-        case 0x6D: this->LD(this->hl.lo, this->hl.lo); return 4; break;
-        case 0x6E: this->LD(this->hl.lo, this->bus.readByte(this->hl.pair)); return 8; break;
-        case 0x6F: this->LD(this->hl.lo, this->af.hi); return 4; break;
-        case 0x70: this->LDMemory(this->hl.pair, this->bc.hi); return 8; break;
-        case 0x71: this->LDMemory(this->hl.pair, this->bc.lo); return 8; break;
-        case 0x72: this->LDMemory(this->hl.pair, this->de.hi); return 8; break;
-        case 0x73: this->LDMemory(this->hl.pair, this->de.lo); return 8; break;
-        case 0x74: this->LDMemory(this->hl.pair, this->hl.hi); return 8; break;
-        case 0x75: this->LDMemory(this->hl.pair, this->hl.lo); return 8; break;
-        case 0x76: this->HALT(); return 4; break;
-        case 0x77: this->LDMemory(this->hl.pair, this->af.hi); return 8; break;
-        case 0x78: this->LD(this->af.hi, this->bc.hi); return 4; break;
-        case 0x79: this->LD(this->af.hi, this->bc.lo); return 4; break;
-        case 0x7A: this->LD(this->af.hi, this->de.hi); return 4; break;
-        case 0x7B: this->LD(this->af.hi, this->de.lo); return 4; break;
-        case 0x7C: this->LD(this->af.hi, this->hl.hi); return 4; break;
-        case 0x7D: this->LD(this->af.hi, this->hl.lo); return 4; break;
-        case 0x7E: this->LD(this->af.hi, this->bus.readByte(this->hl.pair)); return 8; break;
-        case 0x7F: this->LD(this->af.hi, this->af.hi); return 4; break;
-        case 0x80: this->ADD(this->bc.hi, false); return 4; break;
-        case 0x81: this->ADD(this->bc.lo, false); return 4; break;
-        case 0x82: this->ADD(this->de.hi, false); return 4; break;
-        case 0x83: this->ADD(this->de.lo, false); return 4; break;
-        case 0x84: this->ADD(this->hl.hi, false); return 4; break;
-        case 0x85: this->ADD(this->hl.lo, false); return 4; break;
-        case 0x86: this->ADD(this->bus.readByte(this->hl.pair), false); return 8; break;
-        case 0x87: this->ADD(this->af.hi, false); return 4; break;
-        case 0x88: this->ADD(this->bc.hi, this->getFlag(Flag::C)); return 4; break;
-        case 0x89: this->ADD(this->bc.lo, this->getFlag(Flag::C)); return 4; break;
-        case 0x8A: this->ADD(this->de.hi, this->getFlag(Flag::C)); return 4; break;
-        case 0x8B: this->ADD(this->de.lo, this->getFlag(Flag::C)); return 4; break;
-        case 0x8C: this->ADD(this->hl.hi, this->getFlag(Flag::C)); return 4; break;
-        case 0x8D: this->ADD(this->hl.lo, this->getFlag(Flag::C)); return 4; break;
-        case 0x8E: this->ADD(this->bus.readByte(this->hl.pair), this->getFlag(Flag::C)); return 8; break;
-        case 0x8F: this->ADD(this->af.hi, this->getFlag(Flag::C)); return 4; break;
-        case 0x90: this->SUB(this->bc.hi, false); return 4; break;
-        case 0x91: this->SUB(this->bc.lo, false); return 4; break;
-        case 0x92: this->SUB(this->de.hi, false); return 4; break;
-        case 0x93: this->SUB(this->de.lo, false); return 4; break;
-        case 0x94: this->SUB(this->hl.hi, false); return 4; break;
-        case 0x95: this->SUB(this->hl.lo, false); return 4; break;
-        case 0x96: this->SUB(this->bus.readByte(this->hl.pair), false); return 8; break;
-        case 0x97: this->SUB(this->af.hi, false); return 4; break;
-        case 0x98: this->SUB(this->bc.hi, this->getFlag(Flag::C)); return 4; break;
-        case 0x99: this->SUB(this->bc.lo, this->getFlag(Flag::C)); return 4; break;
-        case 0x9A: this->SUB(this->de.hi, this->getFlag(Flag::C)); return 4; break;
-        case 0x9B: this->SUB(this->de.lo, this->getFlag(Flag::C)); return 4; break;
-        case 0x9C: this->SUB(this->hl.hi, this->getFlag(Flag::C)); return 4; break;
-        case 0x9D: this->SUB(this->hl.lo, this->getFlag(Flag::C)); return 4; break;
-        case 0x9E: this->SUB(this->bus.readByte(this->hl.pair), this->getFlag(Flag::C)); return 8; break;
-        case 0x9F: this->SUB(this->af.hi, this->getFlag(Flag::C)); return 4; break;
-        case 0xA0: this->AND(this->bc.hi); return 4; break;
-        case 0xA1: this->AND(this->bc.lo); return 4; break;
-        case 0xA2: this->AND(this->de.hi); return 4; break;
-        case 0xA3: this->AND(this->de.lo); return 4; break;
-        case 0xA4: this->AND(this->hl.hi); return 4; break;
-        case 0xA5: this->AND(this->hl.lo); return 4; break;
-        case 0xA6: this->AND(this->bus.readByte(this->hl.pair)); return 8; break;
-        case 0xA7: this->AND(this->af.hi); return 4; break;
-        case 0xA8: this->XOR(this->bc.hi); return 4; break;
-        case 0xA9: this->XOR(this->bc.lo); return 4; break;
-        case 0xAA: this->XOR(this->de.hi); return 4; break;
-        case 0xAB: this->XOR(this->de.lo); return 4; break;
-        case 0xAC: this->XOR(this->hl.hi); return 4; break;
-        case 0xAD: this->XOR(this->hl.lo); return 4; break;
-        case 0xAE: this->XOR(this->bus.readByte(this->hl.pair)); return 8; break;
-        case 0xAF: this->XOR(this->af.hi); return 4; break;
-        case 0xB0: this->OR(this->bc.hi); return 4; break;
-        case 0xB1: this->OR(this->bc.lo); return 4; break;
-        case 0xB2: this->OR(this->de.hi); return 4; break;
-        case 0xB3: this->OR(this->de.lo); return 4; break;
-        case 0xB4: this->OR(this->hl.hi); return 4; break;
-        case 0xB5: this->OR(this->hl.lo); return 4; break;
-        case 0xB6: this->OR(this->bus.readByte(this->hl.pair)); return 8; break;
-        case 0xB7: this->OR(this->af.hi); return 4; break;
-        case 0xB8: this->CP(this->bc.hi); return 4; break;
-        case 0xB9: this->CP(this->bc.lo); return 4; break;
-        case 0xBA: this->CP(this->de.hi); return 4; break;
-        case 0xBB: this->CP(this->de.lo); return 4; break;
-        case 0xBC: this->CP(this->hl.hi); return 4; break;
-        case 0xBD: this->CP(this->hl.lo); return 4; break;
-        case 0xBE: this->CP(this->bus.readByte(this->hl.pair)); return 8; break;
-        case 0xBF: this->CP(this->af.hi); return 4; break;
-        case 0xC0: this->RET(ConditionCode::NZ, false); return 20; break;
-        case 0xC1: this->POP(this->bc.pair); return 12; break;
-        case 0xC2: this->JP(this->fetchWord(), ConditionCode::NZ); return 16; break;
-        case 0xC3: this->JP(this->fetchWord(), ConditionCode::None); return 16; break;
-        case 0xC4: this->CALL(this->fetchWord(), ConditionCode::NZ); return 24; break;
-        case 0xC5: this->PUSH(this->bc.pair); return 16; break;
-        case 0xC6: this->ADD(this->fetchByte(), false); return 8; break;
-        case 0xC7: this->RST(0x00); return 16; break;
-        case 0xC8: this->RET(ConditionCode::Z, false); return 20; break;
-        case 0xC9: this->RET(ConditionCode::None, false); return 16; break;
-        case 0xCA: this->JP(this->fetchWord(), ConditionCode::Z); return 16; break;
-        case 0xCB: return this->executeExtendedOpcode(this->fetchByte()); break;
-        case 0xCC: this->CALL(this->fetchWord(), ConditionCode::Z); return 24; break;
-        case 0xCD: this->CALL(this->fetchWord(), ConditionCode::None); return 24; break;
-        case 0xCE: this->ADD(this->fetchByte(), this->getFlag(Flag::C)); return 8; break;
-        case 0xCF: this->RST(0x08); return 16; break;
-        case 0xD0: this->RET(ConditionCode::NC, false); return 20; break;
-        case 0xD1: this->POP(this->de.pair); return 12; break;
-        case 0xD2: this->JP(this->fetchWord(), ConditionCode::NC); return 16; break;
-        case 0xD4: this->CALL(this->fetchWord(), ConditionCode::NC); return 24; break;
-        case 0xD5: this->PUSH(this->de.pair); return 16; break;
-        case 0xD6: this->SUB(this->fetchByte(), false); return 8; break;
-        case 0xD7: this->RST(0x10); return 16; break;
-        case 0xD8: this->RET(ConditionCode::C, false); return 20; break;
-        case 0xD9: this->RET(ConditionCode::None, true); return 16; break;
-        case 0xDA: this->JP(this->fetchWord(), ConditionCode::C); return 16; break;
-        case 0xDC: this->CALL(this->fetchWord(), ConditionCode::C); return 24; break;
-        case 0xDE: this->SUB(this->fetchByte(), this->getFlag(Flag::C)); return 8; break;
-        case 0xDF: this->RST(0x18); return 16; break;
-        case 0xE0: this->LDHMemory(this->fetchByte()); return 12; break;
-        case 0xE1: this->POP(this->hl.pair); return 12; break;
-        case 0xE2: this->LDHMemory(this->bc.lo); return 8; break;
-        case 0xE5: this->PUSH(this->hl.pair); return 16; break;
-        case 0xE6: this->AND(this->fetchByte()); return 8; break;
-        case 0xE7: this->RST(0x20); return 16; break;
-        case 0xE8: this->ADDSPRelative(this->fetchByte()); return 16; break;
-        case 0xE9: this->JP(this->hl.pair, ConditionCode::None); return 4; break;
-        case 0xEA: this->LDMemory(this->fetchWord(), this->af.hi); return 16; break;
-        case 0xEE: this->XOR(this->fetchByte()); return 8; break;
-        case 0xEF: this->RST(0x28); return 16; break;
-        case 0xF0: this->LDH(this->fetchByte()); return 12; break;
-        case 0xF1: this->POP(this->af.pair); return 12; break;
-        case 0xF2: this->LD(this->af.hi, this->bus.readByte(0xFF00 + this->bc.lo)); return 8; break;
-        case 0xF3: this->DI(); return 4; break;
-        case 0xF5: this->PUSH(this->af.pair); return 16; break;
-        case 0xF6: this->OR(this->fetchByte()); return 8; break;
-        case 0xF7: this->RST(0x30); return 16; break;
-        case 0xF8: this->LDHLAdjustedSP(this->fetchByte()); return 12; break;
-        case 0xF9: this->LD(this->sp, this->hl.pair); return 8; break;
-        case 0xFA: this->LD(this->af.hi, this->bus.readByte(this->fetchWord())); return 16; break;
-        case 0xFB: this->EI(); return 4; break;
-        case 0xFE: this->CP(this->fetchByte()); return 8; break;
-        case 0xFF: this->RST(0x38); return 16; break;
-        default: return 4; break;
+        case 0x00: this->RLC(this->bc.hi); break;
+        case 0x01: this->RLC(this->bc.lo); break;
+        case 0x02: this->RLC(this->de.hi); break;
+        case 0x03: this->RLC(this->de.lo); break;
+        case 0x04: this->RLC(this->hl.hi); break;
+        case 0x05: this->RLC(this->hl.lo); break;
+        case 0x06: this->RLCMemoryHL(); break;
+        case 0x07: this->RLC(this->af.hi); break;
+        case 0x08: this->RRC(this->bc.hi); break;
+        case 0x09: this->RRC(this->bc.lo); break;
+        case 0x0A: this->RRC(this->de.hi); break;
+        case 0x0B: this->RRC(this->de.lo); break;
+        case 0x0C: this->RRC(this->hl.hi); break;
+        case 0x0D: this->RRC(this->hl.lo); break;
+        case 0x0E: this->RRCMemoryHL(); break;
+        case 0x0F: this->RRC(this->af.hi); break;
+        case 0x10: this->RL(this->bc.hi); break;
+        case 0x11: this->RL(this->bc.lo); break;
+        case 0x12: this->RL(this->de.hi); break;
+        case 0x13: this->RL(this->de.lo); break;
+        case 0x14: this->RL(this->hl.hi); break;
+        case 0x15: this->RL(this->hl.lo); break;
+        case 0x16: this->RLMemoryHL(); break;
+        case 0x17: this->RL(this->af.hi); break;
+        case 0x18: this->RR(this->bc.hi); break;
+        case 0x19: this->RR(this->bc.lo); break;
+        case 0x1A: this->RR(this->de.hi); break;
+        case 0x1B: this->RR(this->de.lo); break;
+        case 0x1C: this->RR(this->hl.hi); break;
+        case 0x1D: this->RR(this->hl.lo); break;
+        case 0x1E: this->RRMemoryHL(); break;
+        case 0x1F: this->RR(this->af.hi); break;
+        case 0x20: this->SLA(this->bc.hi); break;
+        case 0x21: this->SLA(this->bc.lo); break;
+        case 0x22: this->SLA(this->de.hi); break;
+        case 0x23: this->SLA(this->de.lo); break;
+        case 0x24: this->SLA(this->hl.hi); break;
+        case 0x25: this->SLA(this->hl.lo); break;
+        case 0x26: this->SLAMemoryHL(); break;
+        case 0x27: this->SLA(this->af.hi); break;
+        case 0x28: this->SRA(this->bc.hi); break;
+        case 0x29: this->SRA(this->bc.lo); break;
+        case 0x2A: this->SRA(this->de.hi); break;
+        case 0x2B: this->SRA(this->de.lo); break;
+        case 0x2C: this->SRA(this->hl.hi); break;
+        case 0x2D: this->SRA(this->hl.lo); break;
+        case 0x2E: this->SRAMemoryHL(); break;
+        case 0x2F: this->SRA(this->af.hi); break;
+        case 0x30: this->SWAP(this->bc.hi); break;
+        case 0x31: this->SWAP(this->bc.lo); break;
+        case 0x32: this->SWAP(this->de.hi); break;
+        case 0x33: this->SWAP(this->de.lo); break;
+        case 0x34: this->SWAP(this->hl.hi); break;
+        case 0x35: this->SWAP(this->hl.lo); break;
+        case 0x36: this->SWAPMemoryHL(); break;
+        case 0x37: this->SWAP(this->af.hi); break;
+        case 0x38: this->SRL(this->bc.hi); break;
+        case 0x39: this->SRL(this->bc.lo); break;
+        case 0x3A: this->SRL(this->de.hi); break;
+        case 0x3B: this->SRL(this->de.lo); break;
+        case 0x3C: this->SRL(this->hl.hi); break;
+        case 0x3D: this->SRL(this->hl.lo); break;
+        case 0x3E: this->SRLMemoryHL(); break;
+        case 0x3F: this->SRL(this->af.hi); break;
+        case 0x40: this->BIT(1 << 0, this->bc.hi); break;
+        case 0x41: this->BIT(1 << 0, this->bc.lo); break;
+        case 0x42: this->BIT(1 << 0, this->de.hi); break;
+        case 0x43: this->BIT(1 << 0, this->de.lo); break;
+        case 0x44: this->BIT(1 << 0, this->hl.hi); break;
+        case 0x45: this->BIT(1 << 0, this->hl.lo); break;
+        case 0x46: this->BIT(1 << 0, this->bus.readByte(this->hl.pair)); break;
+        case 0x47: this->BIT(1 << 0, this->af.hi); break;
+        case 0x48: this->BIT(1 << 1, this->bc.hi); break;
+        case 0x49: this->BIT(1 << 1, this->bc.lo); break;
+        case 0x4A: this->BIT(1 << 1, this->de.hi); break;
+        case 0x4B: this->BIT(1 << 1, this->de.lo); break;
+        case 0x4C: this->BIT(1 << 1, this->hl.hi); break;
+        case 0x4D: this->BIT(1 << 1, this->hl.lo); break;
+        case 0x4E: this->BIT(1 << 1, this->bus.readByte(this->hl.pair)); break;
+        case 0x4F: this->BIT(1 << 1, this->af.hi); break;
+        case 0x50: this->BIT(1 << 2, this->bc.hi); break;
+        case 0x51: this->BIT(1 << 2, this->bc.lo); break;
+        case 0x52: this->BIT(1 << 2, this->de.hi); break;
+        case 0x53: this->BIT(1 << 2, this->de.lo); break;
+        case 0x54: this->BIT(1 << 2, this->hl.hi); break;
+        case 0x55: this->BIT(1 << 2, this->hl.lo); break;
+        case 0x56: this->BIT(1 << 2, this->bus.readByte(this->hl.pair)); break;
+        case 0x57: this->BIT(1 << 2, this->af.hi); break;
+        case 0x58: this->BIT(1 << 3, this->bc.hi); break;
+        case 0x59: this->BIT(1 << 3, this->bc.lo); break;
+        case 0x5A: this->BIT(1 << 3, this->de.hi); break;
+        case 0x5B: this->BIT(1 << 3, this->de.lo); break;
+        case 0x5C: this->BIT(1 << 3, this->hl.hi); break;
+        case 0x5D: this->BIT(1 << 3, this->hl.lo); break;
+        case 0x5E: this->BIT(1 << 3, this->bus.readByte(this->hl.pair)); break;
+        case 0x5F: this->BIT(1 << 3, this->af.hi); break;
+        case 0x60: this->BIT(1 << 4, this->bc.hi); break;
+        case 0x61: this->BIT(1 << 4, this->bc.lo); break;
+        case 0x62: this->BIT(1 << 4, this->de.hi); break;
+        case 0x63: this->BIT(1 << 4, this->de.lo); break;
+        case 0x64: this->BIT(1 << 4, this->hl.hi); break;
+        case 0x65: this->BIT(1 << 4, this->hl.lo); break;
+        case 0x66: this->BIT(1 << 4, this->bus.readByte(this->hl.pair)); break;
+        case 0x67: this->BIT(1 << 4, this->af.hi); break;
+        case 0x68: this->BIT(1 << 5, this->bc.hi); break;
+        case 0x69: this->BIT(1 << 5, this->bc.lo); break;
+        case 0x6A: this->BIT(1 << 5, this->de.hi); break;
+        case 0x6B: this->BIT(1 << 5, this->de.lo); break;
+        case 0x6C: this->BIT(1 << 5, this->hl.hi); break;
+        case 0x6D: this->BIT(1 << 5, this->hl.lo); break;
+        case 0x6E: this->BIT(1 << 5, this->bus.readByte(this->hl.pair)); break;
+        case 0x6F: this->BIT(1 << 5, this->af.hi); break;
+        case 0x70: this->BIT(1 << 6, this->bc.hi); break;
+        case 0x71: this->BIT(1 << 6, this->bc.lo); break;
+        case 0x72: this->BIT(1 << 6, this->de.hi); break;
+        case 0x73: this->BIT(1 << 6, this->de.lo); break;
+        case 0x74: this->BIT(1 << 6, this->hl.hi); break;
+        case 0x75: this->BIT(1 << 6, this->hl.lo); break;
+        case 0x76: this->BIT(1 << 6, this->bus.readByte(this->hl.pair)); break;
+        case 0x77: this->BIT(1 << 6, this->af.hi); break;
+        case 0x78: this->BIT(1 << 7, this->bc.hi); break;
+        case 0x79: this->BIT(1 << 7, this->bc.lo); break;
+        case 0x7A: this->BIT(1 << 7, this->de.hi); break;
+        case 0x7B: this->BIT(1 << 7, this->de.lo); break;
+        case 0x7C: this->BIT(1 << 7, this->hl.hi); break;
+        case 0x7D: this->BIT(1 << 7, this->hl.lo); break;
+        case 0x7E: this->BIT(1 << 7, this->bus.readByte(this->hl.pair)); break;
+        case 0x7F: this->BIT(1 << 7, this->af.hi); break;
+        case 0x80: this->RES(1 << 0, this->bc.hi); break;
+        case 0x81: this->RES(1 << 0, this->bc.lo); break;
+        case 0x82: this->RES(1 << 0, this->de.hi); break;
+        case 0x83: this->RES(1 << 0, this->de.lo); break;
+        case 0x84: this->RES(1 << 0, this->hl.hi); break;
+        case 0x85: this->RES(1 << 0, this->hl.lo); break;
+        case 0x86: this->RESMemoryHL(1 << 0); break;
+        case 0x87: this->RES(1 << 0, this->af.hi); break;
+        case 0x88: this->RES(1 << 1, this->bc.hi); break;
+        case 0x89: this->RES(1 << 1, this->bc.lo); break;
+        case 0x8A: this->RES(1 << 1, this->de.hi); break;
+        case 0x8B: this->RES(1 << 1, this->de.lo); break;
+        case 0x8C: this->RES(1 << 1, this->hl.hi); break;
+        case 0x8D: this->RES(1 << 1, this->hl.lo); break;
+        case 0x8E: this->RESMemoryHL(1 << 1); break;
+        case 0x8F: this->RES(1 << 1, this->af.hi); break;
+        case 0x90: this->RES(1 << 2, this->bc.hi); break;
+        case 0x91: this->RES(1 << 2, this->bc.lo); break;
+        case 0x92: this->RES(1 << 2, this->de.hi); break;
+        case 0x93: this->RES(1 << 2, this->de.lo); break;
+        case 0x94: this->RES(1 << 2, this->hl.hi); break;
+        case 0x95: this->RES(1 << 2, this->hl.lo); break;
+        case 0x96: this->RESMemoryHL(1 << 2); break;
+        case 0x97: this->RES(1 << 2, this->af.hi); break;
+        case 0x98: this->RES(1 << 3, this->bc.hi); break;
+        case 0x99: this->RES(1 << 3, this->bc.lo); break;
+        case 0x9A: this->RES(1 << 3, this->de.hi); break;
+        case 0x9B: this->RES(1 << 3, this->de.lo); break;
+        case 0x9C: this->RES(1 << 3, this->hl.hi); break;
+        case 0x9D: this->RES(1 << 3, this->hl.lo); break;
+        case 0x9E: this->RESMemoryHL(1 << 3); break;
+        case 0x9F: this->RES(1 << 3, this->af.hi); break;
+        case 0xA0: this->RES(1 << 4, this->bc.hi); break;
+        case 0xA1: this->RES(1 << 4, this->bc.lo); break;
+        case 0xA2: this->RES(1 << 4, this->de.hi); break;
+        case 0xA3: this->RES(1 << 4, this->de.lo); break;
+        case 0xA4: this->RES(1 << 4, this->hl.hi); break;
+        case 0xA5: this->RES(1 << 4, this->hl.lo); break;
+        case 0xA6: this->RESMemoryHL(1 << 4); break;
+        case 0xA7: this->RES(1 << 4, this->af.hi); break;
+        case 0xA8: this->RES(1 << 5, this->bc.hi); break;
+        case 0xA9: this->RES(1 << 5, this->bc.lo); break;
+        case 0xAA: this->RES(1 << 5, this->de.hi); break;
+        case 0xAB: this->RES(1 << 5, this->de.lo); break;
+        case 0xAC: this->RES(1 << 5, this->hl.hi); break;
+        case 0xAD: this->RES(1 << 5, this->hl.lo); break;
+        case 0xAE: this->RESMemoryHL(1 << 5); break;
+        case 0xAF: this->RES(1 << 5, this->af.hi); break;
+        case 0xB0: this->RES(1 << 6, this->bc.hi); break;
+        case 0xB1: this->RES(1 << 6, this->bc.lo); break;
+        case 0xB2: this->RES(1 << 6, this->de.hi); break;
+        case 0xB3: this->RES(1 << 6, this->de.lo); break;
+        case 0xB4: this->RES(1 << 6, this->hl.hi); break;
+        case 0xB5: this->RES(1 << 6, this->hl.lo); break;
+        case 0xB6: this->RESMemoryHL(1 << 6); break;
+        case 0xB7: this->RES(1 << 6, this->af.hi); break;
+        case 0xB8: this->RES(1 << 7, this->bc.hi); break;
+        case 0xB9: this->RES(1 << 7, this->bc.lo); break;
+        case 0xBA: this->RES(1 << 7, this->de.hi); break;
+        case 0xBB: this->RES(1 << 7, this->de.lo); break;
+        case 0xBC: this->RES(1 << 7, this->hl.hi); break;
+        case 0xBD: this->RES(1 << 7, this->hl.lo); break;
+        case 0xBE: this->RESMemoryHL(1 << 7); break;
+        case 0xBF: this->RES(1 << 7, this->af.hi); break;
+        case 0xC0: this->SET(1 << 0, this->bc.hi); break;
+        case 0xC1: this->SET(1 << 0, this->bc.lo); break;
+        case 0xC2: this->SET(1 << 0, this->de.hi); break;
+        case 0xC3: this->SET(1 << 0, this->de.lo); break;
+        case 0xC4: this->SET(1 << 0, this->hl.hi); break;
+        case 0xC5: this->SET(1 << 0, this->hl.lo); break;
+        case 0xC6: this->SETMemoryHL(1 << 0); break;
+        case 0xC7: this->SET(1 << 0, this->af.hi); break;
+        case 0xC8: this->SET(1 << 1, this->bc.hi); break;
+        case 0xC9: this->SET(1 << 1, this->bc.lo); break;
+        case 0xCA: this->SET(1 << 1, this->de.hi); break;
+        case 0xCB: this->SET(1 << 1, this->de.lo); break;
+        case 0xCC: this->SET(1 << 1, this->hl.hi); break;
+        case 0xCD: this->SET(1 << 1, this->hl.lo); break;
+        case 0xCE: this->SETMemoryHL(1 << 1); break;
+        case 0xCF: this->SET(1 << 1, this->af.hi); break;
+        case 0xD0: this->SET(1 << 2, this->bc.hi); break;
+        case 0xD1: this->SET(1 << 2, this->bc.lo); break;
+        case 0xD2: this->SET(1 << 2, this->de.hi); break;
+        case 0xD3: this->SET(1 << 2, this->de.lo); break;
+        case 0xD4: this->SET(1 << 2, this->hl.hi); break;
+        case 0xD5: this->SET(1 << 2, this->hl.lo); break;
+        case 0xD6: this->SETMemoryHL(1 << 2); break;
+        case 0xD7: this->SET(1 << 2, this->af.hi); break;
+        case 0xD8: this->SET(1 << 3, this->bc.hi); break;
+        case 0xD9: this->SET(1 << 3, this->bc.lo); break;
+        case 0xDA: this->SET(1 << 3, this->de.hi); break;
+        case 0xDB: this->SET(1 << 3, this->de.lo); break;
+        case 0xDC: this->SET(1 << 3, this->hl.hi); break;
+        case 0xDD: this->SET(1 << 3, this->hl.lo); break;
+        case 0xDE: this->SETMemoryHL(1 << 3); break;
+        case 0xDF: this->SET(1 << 3, this->af.hi); break;
+        case 0xE0: this->SET(1 << 4, this->bc.hi); break;
+        case 0xE1: this->SET(1 << 4, this->bc.lo); break;
+        case 0xE2: this->SET(1 << 4, this->de.hi); break;
+        case 0xE3: this->SET(1 << 4, this->de.lo); break;
+        case 0xE4: this->SET(1 << 4, this->hl.hi); break;
+        case 0xE5: this->SET(1 << 4, this->hl.lo); break;
+        case 0xE6: this->SETMemoryHL(1 << 4); break;
+        case 0xE7: this->SET(1 << 4, this->af.hi); break;
+        case 0xE8: this->SET(1 << 5, this->bc.hi); break;
+        case 0xE9: this->SET(1 << 5, this->bc.lo); break;
+        case 0xEA: this->SET(1 << 5, this->de.hi); break;
+        case 0xEB: this->SET(1 << 5, this->de.lo); break;
+        case 0xEC: this->SET(1 << 5, this->hl.hi); break;
+        case 0xED: this->SET(1 << 5, this->hl.lo); break;
+        case 0xEE: this->SETMemoryHL(1 << 5); break;
+        case 0xEF: this->SET(1 << 5, this->af.hi); break;
+        case 0xF0: this->SET(1 << 6, this->bc.hi); break;
+        case 0xF1: this->SET(1 << 6, this->bc.lo); break;
+        case 0xF2: this->SET(1 << 6, this->de.hi); break;
+        case 0xF3: this->SET(1 << 6, this->de.lo); break;
+        case 0xF4: this->SET(1 << 6, this->hl.hi); break;
+        case 0xF5: this->SET(1 << 6, this->hl.lo); break;
+        case 0xF6: this->SETMemoryHL(1 << 6); break;
+        case 0xF7: this->SET(1 << 6, this->af.hi); break;
+        case 0xF8: this->SET(1 << 7, this->bc.hi); break;
+        case 0xF9: this->SET(1 << 7, this->bc.lo); break;
+        case 0xFA: this->SET(1 << 7, this->de.hi); break;
+        case 0xFB: this->SET(1 << 7, this->de.lo); break;
+        case 0xFC: this->SET(1 << 7, this->hl.hi); break;
+        case 0xFD: this->SET(1 << 7, this->hl.lo); break;
+        case 0xFE: this->SETMemoryHL(1 << 7); break;
+        case 0xFF: this->SET(1 << 7, this->af.hi); break;
+        default: break;
     }
+
+    return Opcodes::extended[opcode].cycles;
+}
+
+// =================================================================================
+// Dispatch
+// =================================================================================
+
+template<u8 Opcode>
+u8 CPU::handler()
+{
+    return this->execute(Opcode);
+}
+
+template<u8 Opcode>
+u8 CPU::extendedHandler()
+{
+    return this->executeExtended(Opcode);
+}
+
+template<u8 Opcode>
+u8 CPU::threadedHandler(CPU& cpu)
+{
+    return cpu.execute(Opcode);
+}
+
+template<u8 Opcode>
+u8 CPU::threadedExtendedHandler(CPU& cpu)
+{
+    return cpu.executeExtended(Opcode);
+}
+
+#if defined(CPU_DISPATCH_GOTO)
+
+// Computed goto (GCC/Clang extension): one indirect jump straight into the inlined body
+
+u8 CPU::executeOpcode(const u8 opcode)
+{
+    #define OPCODE_LABEL(opcode) &&base##opcode,
+    #define OPCODE_BODY(opcode) base##opcode: return this->execute(opcode);
+
+    static const void* const labels[256] = { OPCODE_LIST(OPCODE_LABEL) };
+
+    goto *labels[opcode];
+    OPCODE_LIST(OPCODE_BODY)
+
+    #undef OPCODE_LABEL
+    #undef OPCODE_BODY
 }
 
 u8 CPU::executeExtendedOpcode(const u8 opcode)
+{
+    #define OPCODE_LABEL(opcode) &&extended##opcode,
+    #define OPCODE_BODY(opcode) extended##opcode: return this->executeExtended(opcode);
+
+    static const void* const labels[256] = { OPCODE_LIST(OPCODE_LABEL) };
+
+    goto *labels[opcode];
+    OPCODE_LIST(OPCODE_BODY)
+
+    #undef OPCODE_LABEL
+    #undef OPCODE_BODY
+}
+
+#elif defined(CPU_DISPATCH_TAILCALL)
+
+// Tail-call threaded: static handlers taking the CPU, entered with a guaranteed tail call
+// where the compiler supports it so no dispatcher frame stays on the stack
+
+#if defined(__has_cpp_attribute) && __has_cpp_attribute(clang::musttail)
+    #define MUSTTAIL [[clang::musttail]]
+#else
+    #define MUSTTAIL
+#endif
+
+u8 CPU::executeOpcode(const u8 opcode)
+{
+    static constexpr auto handlers = []<size_t... I>(std::index_sequence<I...>)
+    {
+        return std::array<ThreadedHandler, 256>{ &CPU::threadedHandler<I>... };
+    }(std::make_index_sequence<256>{});
+
+    MUSTTAIL return handlers[opcode](*this);
+}
+
+u8 CPU::executeExtendedOpcode(const u8 opcode)
+{
+    static constexpr auto handlers = []<size_t... I>(std::index_sequence<I...>)
+    {
+        return std::array<ThreadedHandler, 256>{ &CPU::threadedExtendedHandler<I>... };
+    }(std::make_index_sequence<256>{});
+
+    MUSTTAIL return handlers[opcode](*this);
+}
+
+#else
+
+// Function-pointer table (default): one member function per opcode
+
+u8 CPU::executeOpcode(const u8 opcode)
+{
+    static constexpr auto handlers = []<size_t... I>(std::index_sequence<I...>)
+    {
+        return std::array<Handler, 256>{ &CPU::handler<I>... };
+    }(std::make_index_sequence<256>{});
+
+    return (this->*handlers[opcode])();
+}
+
+u8 CPU::executeExtendedOpcode(const u8 opcode)
+{
+    static constexpr auto handlers = []<size_t... I>(std::index_sequence<I...>)
+    {
+        return std::array<Handler, 256>{ &CPU::extendedHandler<I>... };
+    }(std::make_index_sequence<256>{});
+
+    return (this->*handlers[opcode])();
+}
+
+#endif
+
+// =================================================================================
+// Idle Loop Detection
+// =================================================================================
+
+// A busy-wait loop such as "LDH A,(0x44) / CP n / JR NZ" only reads registers that change
+// when a scheduled event runs. Once two consecutive iterations leave the registers untouched
+// in the same number of cycles, every further iteration before the next event is identical
+// and can be skipped in whole.
+
+bool CPU::isIdleLoopBody(const u16 start, const u16 end, u16& maxPeriod) const
+{
+    // Reading code from IO would have side effects
+    if(end > 0xFE00 || end - start > 16)
+        return false;
+
+    u16 addr = start;
+    u16 instructions = 0;
+
+    while(addr < end)
+    {
+        const u8 opcode = this->bus.readByte(addr);
+        u8 length = 1;
+        bool reads = false;
+        u16 readAddr = 0;
+
+        switch(opcode)
+        {
+            case 0x00:
+                break;
+            case 0x0A:
+                reads = true;
+                readAddr = this->bc.pair;
+                break;
+            case 0x1A:
+                reads = true;
+                readAddr = this->de.pair;
+                break;
+            case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+            case 0xC6: case 0xCE: case 0xD6: case 0xDE: case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+                length = 2;
+                break;
+            case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA:
+                length = 3;
+                break;
+            case 0xF0:
+                reads = true;
+                readAddr = 0xFF00 | this->bus.readByte(addr + 1);
+                length = 2;
+                break;
+            case 0xFA:
+                reads = true;
+                readAddr = this->bus.readWord(addr + 1);
+                length = 3;
+                break;
+            case 0xCB:
+            {
+                // Only BIT leaves its operand untouched
+                const u8 extended = this->bus.readByte(addr + 1);
+                if((extended & 0xC0) != 0x40)
+                    return false;
+
+                reads = (extended & 0x07) == 0x06;
+                readAddr = this->hl.pair;
+                length = 2;
+                break;
+            }
+            default:
+                // LD A,r and 8-bit ALU operations on A, nothing else writes a register
+                if(opcode < 0x78 || opcode > 0xBF)
+                    return false;
+
+                reads = (opcode & 0x07) == 0x06;
+                readAddr = this->hl.pair;
+                break;
+        }
+
+        // DIV and TIMA are derived from the current cycle and change without an event
+        if(reads && (readAddr == 0xFF04 || readAddr == 0xFF05))
+            return false;
+
+        addr += length;
+        ++instructions;
+    }
+
+    // No instruction in the body plus the closing JR takes more than 16 cycles
+    maxPeriod = (instructions + 1) * 16;
+
+    return addr == end;
+}
+
+void CPU::checkIdleLoop(const u16 branch)
+{
+    IdleLoop& loop = this->idleLoop;
+
+    #ifdef LAZY_FLAGS
+        const u8 flags = this->flagState.op != FlagOp::None ? CPU::computeFlags(this->flagState) : this->af.lo;
+    #else
+        const u8 flags = this->af.lo;
+    #endif
+
+    const u16 registers[5] = {static_cast<u16>(this->af.hi << 8 | flags), this->bc.pair, this->de.pair, this->hl.pair, this->sp};
+
+    if(loop.start != this->pc || loop.branch != branch)
+    {
+        loop.start = this->pc;
+        loop.branch = branch;
+        loop.idle = this->isIdleLoopBody(this->pc, branch, loop.maxPeriod);
+        loop.period = 0;
+    }
+    else if(loop.idle)
+    {
+        const u64 period = this->scheduler.now - loop.timestamp;
+        const bool unchanged = memcmp(registers, loop.registers, sizeof(registers)) == 0;
+
+        if(unchanged && period == loop.period && period <= loop.maxPeriod && loop.deadline == this->scheduler.deadline && this->scheduler.deadline > this->scheduler.now)
+        {
+            // Land strictly before the deadline, as this JR would have run before the event too. Every
+            // skipped iteration then starts before the deadline and would have read the same values.
+            const u64 iterations = (this->scheduler.deadline - this->scheduler.now - 1) / period;
+
+            if(iterations)
+            {
+                this->scheduler.now += iterations * period;
+
+                ++this->idleLoopStats.loops;
+                this->idleLoopStats.cycles += iterations * period;
+            }
+        }
+
+        loop.period = unchanged ? period : 0;
+    }
+
+    loop.timestamp = this->scheduler.now;
+    loop.deadline = this->scheduler.deadline;
+    memcpy(loop.registers, registers, sizeof(registers));
+}
+
+void CPU::forgetIdleLoop()
+{
+    this->idleLoop.start = 0;
+    this->idleLoop.branch = 0;
+    this->idleLoop.period = 0;
+}
+
+// =================================================================================
+// Block Cache
+// =================================================================================
+
+bool CPU::endsBlock(const u8 opcode)
 {
     switch(opcode)
     {
-        case 0x00: this->RLC(this->bc.hi); return 8; break;
-        case 0x01: this->RLC(this->bc.lo); return 8; break;
-        case 0x02: this->RLC(this->de.hi); return 8; break;
-        case 0x03: this->RLC(this->de.lo); return 8; break;
-        case 0x04: this->RLC(this->hl.hi); return 8; break;
-        case 0x05: this->RLC(this->hl.lo); return 8; break;
-        case 0x06: this->RLCMemoryHL(); return 16; break;
-        case 0x07: this->RLC(this->af.hi); return 8; break;
-        case 0x08: this->RRC(this->bc.hi); return 8; break;
-        case 0x09: this->RRC(this->bc.lo); return 8; break;
-        case 0x0A: this->RRC(this->de.hi); return 8; break;
-        case 0x0B: this->RRC(this->de.lo); return 8; break;
-        case 0x0C: this->RRC(this->hl.hi); return 8; break;
-        case 0x0D: this->RRC(this->hl.lo); return 8; break;
-        case 0x0E: this->RRCMemoryHL(); return 16; break;
-        case 0x0F: this->RRC(this->af.hi); return 8; break;
-        case 0x10: this->RL(this->bc.hi); return 8; break;
-        case 0x11: this->RL(this->bc.lo); return 8; break;
-        case 0x12: this->RL(this->de.hi); return 8; break;
-        case 0x13: this->RL(this->de.lo); return 8; break;
-        case 0x14: this->RL(this->hl.hi); return 8; break;
-        case 0x15: this->RL(this->hl.lo); return 8; break;
-        case 0x16: this->RLMemoryHL(); return 16; break;
-        case 0x17: this->RL(this->af.hi); return 8; break;
-        case 0x18: this->RR(this->bc.hi); return 8; break;
-        case 0x19: this->RR(this->bc.lo); return 8; break;
-        case 0x1A: this->RR(this->de.hi); return 8; break;
-        case 0x1B: this->RR(this->de.lo); return 8; break;
-        case 0x1C: this->RR(this->hl.hi); return 8; break;
-        case 0x1D: this->RR(this->hl.lo); return 8; break;
-        case 0x1E: this->RRMemoryHL(); return 16; break;
-        case 0x1F: this->RR(this->af.hi); return 8; break;
-        case 0x20: this->SLA(this->bc.hi); return 8; break;
-        case 0x21: this->SLA(this->bc.lo); return 8; break;
-        case 0x22: this->SLA(this->de.hi); return 8; break;
-        case 0x23: this->SLA(this->de.lo); return 8; break;
-        case 0x24: this->SLA(this->hl.hi); return 8; break;
-        case 0x25: this->SLA(this->hl.lo); return 8; break;
-        case 0x26: this->SLAMemoryHL(); return 16; break;
-        case 0x27: this->SLA(this->af.hi); return 8; break;
-        case 0x28: this->SRA(this->bc.hi); return 8; break;
-        case 0x29: this->SRA(this->bc.lo); return 8; break;
-        case 0x2A: this->SRA(this->de.hi); return 8; break;
-        case 0x2B: this->SRA(this->de.lo); return 8; break;
-        case 0x2C: this->SRA(this->hl.hi); return 8; break;
-        case 0x2D: this->SRA(this->hl.lo); return 8; break;
-        case 0x2E: this->SRAMemoryHL(); return 16; break;
-        case 0x2F: this->SRA(this->af.hi); return 8; break;
-        case 0x30: this->SWAP(this->bc.hi); return 8; break;
-        case 0x31: this->SWAP(this->bc.lo); return 8; break;
-        case 0x32: this->SWAP(this->de.hi); return 8; break;
-        case 0x33: this->SWAP(this->de.lo); return 8; break;
-        case 0x34: this->SWAP(this->hl.hi); return 8; break;
-        case 0x35: this->SWAP(this->hl.lo); return 8; break;
-        case 0x36: this->SWAPMemoryHL(); return 16; break;
-        case 0x37: this->SWAP(this->af.hi); return 8; break;
-        case 0x38: this->SRL(this->bc.hi); return 8; break;
-        case 0x39: this->SRL(this->bc.lo); return 8; break;
-        case 0x3A: this->SRL(this->de.hi); return 8; break;
-        case 0x3B: this->SRL(this->de.lo); return 8; break;
-        case 0x3C: this->SRL(this->hl.hi); return 8; break;
-        case 0x3D: this->SRL(this->hl.lo); return 8; break;
-        case 0x3E: this->SRLMemoryHL(); return 16; break;
-        case 0x3F: this->SRL(this->af.hi); return 8; break;
-        case 0x40: this->BIT(1 << 0, this->bc.hi); return 8; break;
-        case 0x41: this->BIT(1 << 0, this->bc.lo); return 8; break;
-        case 0x42: this->BIT(1 << 0, this->de.hi); return 8; break;
-        case 0x43: this->BIT(1 << 0, this->de.lo); return 8; break;
-        case 0x44: this->BIT(1 << 0, this->hl.hi); return 8; break;
-        case 0x45: this->BIT(1 << 0, this->hl.lo); return 8; break;
-        case 0x46: this->BIT(1 << 0, this->bus.readByte(this->hl.pair)); return 16; break;
-        case 0x47: this->BIT(1 << 0, this->af.hi); return 8; break;
-        case 0x48: this->BIT(1 << 1, this->bc.hi); return 8; break;
-        case 0x49: this->BIT(1 << 1, this->bc.lo); return 8; break;
-        case 0x4A: this->BIT(1 << 1, this->de.hi); return 8; break;
-        case 0x4B: this->BIT(1 << 1, this->de.lo); return 8; break;
-        case 0x4C: this->BIT(1 << 1, this->hl.hi); return 8; break;
-        case 0x4D: this->BIT(1 << 1, this->hl.lo); return 8; break;
-        case 0x4E: this->BIT(1 << 1, this->bus.readByte(this->hl.pair)); return 16; break;
-        case 0x4F: this->BIT(1 << 1, this->af.hi); return 8; break;
-        case 0x50: this->BIT(1 << 2, this->bc.hi); return 8; break;
-        case 0x51: this->BIT(1 << 2, this->bc.lo); return 8; break;
-        case 0x52: this->BIT(1 << 2, this->de.hi); return 8; break;
-        case 0x53: this->BIT(1 << 2, this->de.lo); return 8; break;
-        case 0x54: this->BIT(1 << 2, this->hl.hi); return 8; break;
-        case 0x55: this->BIT(1 << 2, this->hl.lo); return 8; break;
-        case 0x56: this->BIT(1 << 2, this->bus.readByte(this->hl.pair)); return 16; break;
-        case 0x57: this->BIT(1 << 2, this->af.hi); return 8; break;
-        case 0x58: this->BIT(1 << 3, this->bc.hi); return 8; break;
-        case 0x59: this->BIT(1 << 3, this->bc.lo); return 8; break;
-        case 0x5A: this->BIT(1 << 3, this->de.hi); return 8; break;
-        case 0x5B: this->BIT(1 << 3, this->de.lo); return 8; break;
-        case 0x5C: this->BIT(1 << 3, this->hl.hi); return 8; break;
-        case 0x5D: this->BIT(1 << 3, this->hl.lo); return 8; break;
-        case 0x5E: this->BIT(1 << 3, this->bus.readByte(this->hl.pair)); return 16; break;
-        case 0x5F: this->BIT(1 << 3, this->af.hi); return 8; break;
-        case 0x60: this->BIT(1 << 4, this->bc.hi); return 8; break;
-        case 0x61: this->BIT(1 << 4, this->bc.lo); return 8; break;
-        case 0x62: this->BIT(1 << 4, this->de.hi); return 8; break;
-        case 0x63: this->BIT(1 << 4, this->de.lo); return 8; break;
-        case 0x64: this->BIT(1 << 4, this->hl.hi); return 8; break;
-        case 0x65: this->BIT(1 << 4, this->hl.lo); return 8; break;
-        case 0x66: this->BIT(1 << 4, this->bus.readByte(this->hl.pair)); return 16; break;
-        case 0x67: this->BIT(1 << 4, this->af.hi); return 8; break;
-        case 0x68: this->BIT(1 << 5, this->bc.hi); return 8; break;
-        case 0x69: this->BIT(1 << 5, this->bc.lo); return 8; break;
-        case 0x6A: this->BIT(1 << 5, this->de.hi); return 8; break;
-        case 0x6B: this->BIT(1 << 5, this->de.lo); return 8; break;
-        case 0x6C: this->BIT(1 << 5, this->hl.hi); return 8; break;
-        case 0x6D: this->BIT(1 << 5, this->hl.lo); return 8; break;
-        case 0x6E: this->BIT(1 << 5, this->bus.readByte(this->hl.pair)); return 16; break;
-        case 0x6F: this->BIT(1 << 5, this->af.hi); return 8; break;
-        case 0x70: this->BIT(1 << 6, this->bc.hi); return 8; break;
-        case 0x71: this->BIT(1 << 6, this->bc.lo); return 8; break;
-        case 0x72: this->BIT(1 << 6, this->de.hi); return 8; break;
-        case 0x73: this->BIT(1 << 6, this->de.lo); return 8; break;
-        case 0x74: this->BIT(1 << 6, this->hl.hi); return 8; break;
-        case 0x75: this->BIT(1 << 6, this->hl.lo); return 8; break;
-        case 0x76: this->BIT(1 << 6, this->bus.readByte(this->hl.pair)); return 16; break;
-        case 0x77: this->BIT(1 << 6, this->af.hi); return 8; break;
-        case 0x78: this->BIT(1 << 7, this->bc.hi); return 8; break;
-        case 0x79: this->BIT(1 << 7, this->bc.lo); return 8; break;
-        case 0x7A: this->BIT(1 << 7, this->de.hi); return 8; break;
-        case 0x7B: this->BIT(1 << 7, this->de.lo); return 8; break;
-        case 0x7C: this->BIT(1 << 7, this->hl.hi); return 8; break;
-        case 0x7D: this->BIT(1 << 7, this->hl.lo); return 8; break;
-        case 0x7E: this->BIT(1 << 7, this->bus.readByte(this->hl.pair)); return 16; break;
-        case 0x7F: this->BIT(1 << 7, this->af.hi); return 8; break;
-        case 0x80: this->RES(1 << 0, this->bc.hi); return 8; break;
-        case 0x81: this->RES(1 << 0, this->bc.lo); return 8; break;
-        case 0x82: this->RES(1 << 0, this->de.hi); return 8; break;
-        case 0x83: this->RES(1 << 0, this->de.lo); return 8; break;
-        case 0x84: this->RES(1 << 0, this->hl.hi); return 8; break;
-        case 0x85: this->RES(1 << 0, this->hl.lo); return 8; break;
-        case 0x86: this->RESMemoryHL(1 << 0); return 16; break;
-        case 0x87: this->RES(1 << 0, this->af.hi); return 8; break;
-        case 0x88: this->RES(1 << 1, this->bc.hi); return 8; break;
-        case 0x89: this->RES(1 << 1, this->bc.lo); return 8; break;
-        case 0x8A: this->RES(1 << 1, this->de.hi); return 8; break;
-        case 0x8B: this->RES(1 << 1, this->de.lo); return 8; break;
-        case 0x8C: this->RES(1 << 1, this->hl.hi); return 8; break;
-        case 0x8D: this->RES(1 << 1, this->hl.lo); return 8; break;
-        case 0x8E: this->RESMemoryHL(1 << 1); return 16; break;
-        case 0x8F: this->RES(1 << 1, this->af.hi); return 8; break;
-        case 0x90: this->RES(1 << 2, this->bc.hi); return 8; break;
-        case 0x91: this->RES(1 << 2, this->bc.lo); return 8; break;
-        case 0x92: this->RES(1 << 2, this->de.hi); return 8; break;
-        case 0x93: this->RES(1 << 2, this->de.lo); return 8; break;
-        case 0x94: this->RES(1 << 2, this->hl.hi); return 8; break;
-        case 0x95: this->RES(1 << 2, this->hl.lo); return 8; break;
-        case 0x96: this->RESMemoryHL(1 << 2); return 16; break;
-        case 0x97: this->RES(1 << 2, this->af.hi); return 8; break;
-        case 0x98: this->RES(1 << 3, this->bc.hi); return 8; break;
-        case 0x99: this->RES(1 << 3, this->bc.lo); return 8; break;
-        case 0x9A: this->RES(1 << 3, this->de.hi); return 8; break;
-        case 0x9B: this->RES(1 << 3, this->de.lo); return 8; break;
-        case 0x9C: this->RES(1 << 3, this->hl.hi); return 8; break;
-        case 0x9D: this->RES(1 << 3, this->hl.lo); return 8; break;
-        case 0x9E: this->RESMemoryHL(1 << 3); return 16; break;
-        case 0x9F: this->RES(1 << 3, this->af.hi); return 8; break;
-        case 0xA0: this->RES(1 << 4, this->bc.hi); return 8; break;
-        case 0xA1: this->RES(1 << 4, this->bc.lo); return 8; break;
-        case 0xA2: this->RES(1 << 4, this->de.hi); return 8; break;
-        case 0xA3: this->RES(1 << 4, this->de.lo); return 8; break;
-        case 0xA4: this->RES(1 << 4, this->hl.hi); return 8; break;
-        case 0xA5: this->RES(1 << 4, this->hl.lo); return 8; break;
-        case 0xA6: this->RESMemoryHL(1 << 4); return 16; break;
-        case 0xA7: this->RES(1 << 4, this->af.hi); return 8; break;
-        case 0xA8: this->RES(1 << 5, this->bc.hi); return 8; break;
-        case 0xA9: this->RES(1 << 5, this->bc.lo); return 8; break;
-        case 0xAA: this->RES(1 << 5, this->de.hi); return 8; break;
-        case 0xAB: this->RES(1 << 5, this->de.lo); return 8; break;
-        case 0xAC: this->RES(1 << 5, this->hl.hi); return 8; break;
-        case 0xAD: this->RES(1 << 5, this->hl.lo); return 8; break;
-        case 0xAE: this->RESMemoryHL(1 << 5); return 16; break;
-        case 0xAF: this->RES(1 << 5, this->af.hi); return 8; break;
-        case 0xB0: this->RES(1 << 6, this->bc.hi); return 8; break;
-        case 0xB1: this->RES(1 << 6, this->bc.lo); return 8; break;
-        case 0xB2: this->RES(1 << 6, this->de.hi); return 8; break;
-        case 0xB3: this->RES(1 << 6, this->de.lo); return 8; break;
-        case 0xB4: this->RES(1 << 6, this->hl.hi); return 8; break;
-        case 0xB5: this->RES(1 << 6, this->hl.lo); return 8; break;
-        case 0xB6: this->RESMemoryHL(1 << 6); return 16; break;
-        case 0xB7: this->RES(1 << 6, this->af.hi); return 8; break;
-        case 0xB8: this->RES(1 << 7, this->bc.hi); return 8; break;
-        case 0xB9: this->RES(1 << 7, this->bc.lo); return 8; break;
-        case 0xBA: this->RES(1 << 7, this->de.hi); return 8; break;
-        case 0xBB: this->RES(1 << 7, this->de.lo); return 8; break;
-        case 0xBC: this->RES(1 << 7, this->hl.hi); return 8; break;
-        case 0xBD: this->RES(1 << 7, this->hl.lo); return 8; break;
-        case 0xBE: this->RESMemoryHL(1 << 7); return 16; break;
-        case 0xBF: this->RES(1 << 7, this->af.hi); return 8; break;
-        case 0xC0: this->SET(1 << 0, this->bc.hi); return 8; break;
-        case 0xC1: this->SET(1 << 0, this->bc.lo); return 8; break;
-        case 0xC2: this->SET(1 << 0, this->de.hi); return 8; break;
-        case 0xC3: this->SET(1 << 0, this->de.lo); return 8; break;
-        case 0xC4: this->SET(1 << 0, this->hl.hi); return 8; break;
-        case 0xC5: this->SET(1 << 0, this->hl.lo); return 8; break;
-        case 0xC6: this->SETMemoryHL(1 << 0); return 16; break;
-        case 0xC7: this->SET(1 << 0, this->af.hi); return 8; break;
-        case 0xC8: this->SET(1 << 1, this->bc.hi); return 8; break;
-        case 0xC9: this->SET(1 << 1, this->bc.lo); return 8; break;
-        case 0xCA: this->SET(1 << 1, this->de.hi); return 8; break;
-        case 0xCB: this->SET(1 << 1, this->de.lo); return 8; break;
-        case 0xCC: this->SET(1 << 1, this->hl.hi); return 8; break;
-        case 0xCD: this->SET(1 << 1, this->hl.lo); return 8; break;
-        case 0xCE: this->SETMemoryHL(1 << 1); return 16; break;
-        case 0xCF: this->SET(1 << 1, this->af.hi); return 8; break;
-        case 0xD0: this->SET(1 << 2, this->bc.hi); return 8; break;
-        case 0xD1: this->SET(1 << 2, this->bc.lo); return 8; break;
-        case 0xD2: this->SET(1 << 2, this->de.hi); return 8; break;
-        case 0xD3: this->SET(1 << 2, this->de.lo); return 8; break;
-        case 0xD4: this->SET(1 << 2, this->hl.hi); return 8; break;
-        case 0xD5: this->SET(1 << 2, this->hl.lo); return 8; break;
-        case 0xD6: this->SETMemoryHL(1 << 2); return 16; break;
-        case 0xD7: this->SET(1 << 2, this->af.hi); return 8; break;
-        case 0xD8: this->SET(1 << 3, this->bc.hi); return 8; break;
-        case 0xD9: this->SET(1 << 3, this->bc.lo); return 8; break;
-        case 0xDA: this->SET(1 << 3, this->de.hi); return 8; break;
-        case 0xDB: this->SET(1 << 3, this->de.lo); return 8; break;
-        case 0xDC: this->SET(1 << 3, this->hl.hi); return 8; break;
-        case 0xDD: this->SET(1 << 3, this->hl.lo); return 8; break;
-        case 0xDE: this->SETMemoryHL(1 << 3); return 16; break;
-        case 0xDF: this->SET(1 << 3, this->af.hi); return 8; break;
-        case 0xE0: this->SET(1 << 4, this->bc.hi); return 8; break;
-        case 0xE1: this->SET(1 << 4, this->bc.lo); return 8; break;
-        case 0xE2: this->SET(1 << 4, this->de.hi); return 8; break;
-        case 0xE3: this->SET(1 << 4, this->de.lo); return 8; break;
-        case 0xE4: this->SET(1 << 4, this->hl.hi); return 8; break;
-        case 0xE5: this->SET(1 << 4, this->hl.lo); return 8; break;
-        case 0xE6: this->SETMemoryHL(1 << 4); return 16; break;
-        case 0xE7: this->SET(1 << 4, this->af.hi); return 8; break;
-        case 0xE8: this->SET(1 << 5, this->bc.hi); return 8; break;
-        case 0xE9: this->SET(1 << 5, this->bc.lo); return 8; break;
-        case 0xEA: this->SET(1 << 5, this->de.hi); return 8; break;
-        case 0xEB: this->SET(1 << 5, this->de.lo); return 8; break;
-        case 0xEC: this->SET(1 << 5, this->hl.hi); return 8; break;
-        case 0xED: this->SET(1 << 5, this->hl.lo); return 8; break;
-        case 0xEE: this->SETMemoryHL(1 << 5); return 16; break;
-        case 0xEF: this->SET(1 << 5, this->af.hi); return 8; break;
-        case 0xF0: this->SET(1 << 6, this->bc.hi); return 8; break;
-        case 0xF1: this->SET(1 << 6, this->bc.lo); return 8; break;
-        case 0xF2: this->SET(1 << 6, this->de.hi); return 8; break;
-        case 0xF3: this->SET(1 << 6, this->de.lo); return 8; break;
-        case 0xF4: this->SET(1 << 6, this->hl.hi); return 8; break;
-        case 0xF5: this->SET(1 << 6, this->hl.lo); return 8; break;
-        case 0xF6: this->SETMemoryHL(1 << 6); return 16; break;
-        case 0xF7: this->SET(1 << 6, this->af.hi); return 8; break;
-        case 0xF8: this->SET(1 << 7, this->bc.hi); return 8; break;
-        case 0xF9: this->SET(1 << 7, this->bc.lo); return 8; break;
-        case 0xFA: this->SET(1 << 7, this->de.hi); return 8; break;
-        case 0xFB: this->SET(1 << 7, this->de.lo); return 8; break;
-        case 0xFC: this->SET(1 << 7, this->hl.hi); return 8; break;
-        case 0xFD: this->SET(1 << 7, this->hl.lo); return 8; break;
-        case 0xFE: this->SETMemoryHL(1 << 7); return 16; break;
-        case 0xFF: this->SET(1 << 7, this->af.hi); return 8; break;
-        default: return 8; break;
+        // JR, JP, CALL, RET, RETI, RST
+        case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+        case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: case 0xE9:
+        case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC:
+        case 0xC0: case 0xC8: case 0xC9: case 0xD0: case 0xD8: case 0xD9:
+        case 0xC7: case 0xCF: case 0xD7: case 0xDF: case 0xE7: case 0xEF: case 0xF7: case 0xFF:
+        // HALT, STOP and EI change how the next instruction starts
+        case 0x76: case 0x10: case 0xFB:
+            return true;
+        default:
+            return false;
     }
 }
 
+void CPU::flushBlockCache()
+{
+    for(Block& block : this->blocks)
+        block.code = nullptr;
+
+    #ifdef CPU_JIT
+        this->resetJIT();
+    #endif
+}
+
+void CPU::invalidateCodePage(const u8 page)
+{
+    ++this->codeGenerations[page];
+}
+
+CPU::Block* CPU::getBlock()
+{
+    const u8 pageIndex = this->pc >> 8;
+    const u8* page = this->bus.readPages[pageIndex];
+
+    // Code in VRAM, cart RAM or HRAM is rare and runs uncached
+    u8 region;
+    if(pageIndex < 0x80)
+        region = CPU::romRegion;
+    else if(pageIndex >= 0xC0 && pageIndex <= 0xFD)
+        region = (pageIndex - 0xC0) & 0x1F;
+    else
+        return nullptr;
+
+    if(!page)
+        return nullptr;
+
+    const u8* code = page + (this->pc & 0xFF);
+    const uintptr_t key = reinterpret_cast<uintptr_t>(code);
+
+    Block& block = this->blocks[(key ^ (key >> 11)) & (CPU::blockCacheSize - 1)];
+
+    if(block.code == code && block.pc == this->pc && (block.region == CPU::romRegion || block.generation == this->codeGenerations[block.region]))
+        return &block;
+
+    if(!this->decodeBlock(block, page, region))
+        return nullptr;
+
+    return &block;
+}
+
+bool CPU::decodeBlock(Block& block, const u8* page, const u8 region)
+{
+    u16 offset = this->pc & 0xFF;
+    u8 count = 0;
+
+    while(count < CPU::maxBlockInstructions)
+    {
+        const u8 opcode = page[offset];
+        const u8 length = Opcodes::base[opcode].length;
+
+        // Instructions straddling the page end run uncached
+        if(offset + length > 0x100)
+            break;
+
+        DecodedInstruction& instruction = block.instructions[count++];
+        instruction.opcode = opcode;
+        instruction.length = length;
+
+        if(length == 3)
+            instruction.operand = page[offset + 1] | (page[offset + 2] << 8);
+        else if(length == 2)
+            instruction.operand = page[offset + 1];
+        else
+            instruction.operand = 0;
+
+        offset += length;
+
+        if(CPU::endsBlock(opcode) || offset == 0x100)
+            break;
+    }
+
+    if(count == 0)
+    {
+        block.code = nullptr;
+        return false;
+    }
+
+    block.code = page + (this->pc & 0xFF);
+    block.page = page;
+    block.pc = this->pc;
+    block.region = region;
+    block.count = count;
+
+    #ifdef CPU_JIT
+        block.maxCycles = 0;
+        for(u8 i = 0; i < count; ++i)
+            block.maxCycles += Opcodes::getMaxCycles(block.instructions[i].opcode, block.instructions[i].operand & 0xFF);
+
+        block.hits = 0;
+        block.compiled = nullptr;
+    #endif
+
+    if(region != CPU::romRegion)
+    {
+        block.generation = this->codeGenerations[region];
+        this->bus.protectCodePage(region);
+    }
+
+    return true;
+}
+
+void CPU::runBlock()
+{
+    Block* block = this->getBlock();
+
+    if(!block)
+    {
+        this->scheduler.now += this->step();
+        return;
+    }
+
+    #ifdef CPU_JIT
+        // RAM code may modify itself and always stays in the interpreter
+        if(block->region == CPU::romRegion && this->runCompiledBlock(*block))
+            return;
+    #endif
+
+    for(u8 i = 0; i < block->count; ++i)
+    {
+        const DecodedInstruction& instruction = block->instructions[i];
+
+        this->pc += instruction.length;
+        this->operand = instruction.operand;
+        this->scheduler.now += this->executeOpcode(instruction.opcode);
+
+        if(this->scheduler.now >= this->scheduler.deadline)
+            break;
+
+        if(this->interrupts.ime && (this->interrupts.flag & this->interrupts.enable))
+            break;
+
+        // The rest of the block may no longer be what is mapped (bank switch) or stored (self-modifying code)
+        if(this->bus.readPages[block->pc >> 8] != block->page)
+            break;
+
+        if(block->region != CPU::romRegion && block->generation != this->codeGenerations[block->region])
+            break;
+    }
+}
+
+// =================================================================================
+// JIT
+// =================================================================================
+
+#ifdef CPU_JIT
+
+CPU::ThreadedHandler CPU::getThreadedHandler(const u8 opcode, const bool extended)
+{
+    static constexpr auto handlers = []<size_t... I>(std::index_sequence<I...>)
+    {
+        return std::array<ThreadedHandler, 256>{ &CPU::threadedHandler<I>... };
+    }(std::make_index_sequence<256>{});
+
+    static constexpr auto extendedHandlers = []<size_t... I>(std::index_sequence<I...>)
+    {
+        return std::array<ThreadedHandler, 256>{ &CPU::threadedExtendedHandler<I>... };
+    }(std::make_index_sequence<256>{});
+
+    return extended ? extendedHandlers[opcode] : handlers[opcode];
+}
+
+bool CPU::shouldExitCompiledBlock(CPU* cpu, const u32 remaining, const u8* page)
+{
+    if(cpu->interrupts.ime && (cpu->interrupts.flag & cpu->interrupts.enable))
+        return true;
+
+    // A write switched the ROM bank the block runs from
+    if(cpu->bus.readPages[cpu->pc >> 8] != page)
+        return true;
+
+    // A write scheduled an event earlier than the deadline the block was entered for
+    return cpu->scheduler.now + remaining > cpu->scheduler.deadline;
+}
+
+void CPU::resetJIT()
+{
+    this->jit->reset();
+
+    for(Block& block : this->blocks)
+    {
+        block.hits = 0;
+        block.compiled = nullptr;
+    }
+}
+
+bool CPU::runCompiledBlock(Block& block)
+{
+    if(!block.compiled)
+    {
+        if(++block.hits < CPU::jitThreshold)
+            return false;
+
+        block.compiled = this->jit->compile(*this, block);
+
+        if(!block.compiled)
+        {
+            // The code arena is full, start over
+            this->resetJIT();
+            return false;
+        }
+
+        ++this->jitStats.blocks;
+    }
+
+    // Exit to the scheduler instead if the block could run past the next event
+    if(this->scheduler.now + block.maxCycles > this->scheduler.deadline)
+        return false;
+
+    if(this->options.jitLockstep)
+        this->runLockstep(block);
+    else
+        block.compiled(this, &this->scheduler.now);
+
+    return true;
+}
+
+// Run the compiled block, then rewind the machine and run the interpreter up to the same cycle
+// and compare. Memory and interrupt state is rewound too, IO writes are simply repeated at the
+// same cycles. Blocks that switch ROM or RAM banks can't be rewound and are not compared.
+void CPU::runLockstep(Block& block)
+{
+    struct Registers
+    {
+        Register af, bc, de, hl;
+        u16 sp, pc, operand;
+        FlagState flagState;
+        bool delayIme, halted, haltBug;
+        IdleLoop idleLoop;
+        IdleLoopStats idleLoopStats;
+        bool ime;
+        u8 flag, enable;
+        u64 now;
+    };
+
+    const auto save = [this]()
+    {
+        return Registers{this->af, this->bc, this->de, this->hl, this->sp, this->pc, this->operand, this->flagState, this->delayIme, this->halted, this->haltBug, this->idleLoop, this->idleLoopStats, this->interrupts.ime, this->interrupts.flag, this->interrupts.enable, this->scheduler.now};
+    };
+
+    const auto restore = [this](const Registers& registers)
+    {
+        this->af = registers.af; this->bc = registers.bc; this->de = registers.de; this->hl = registers.hl;
+        this->sp = registers.sp; this->pc = registers.pc; this->operand = registers.operand;
+        this->flagState = registers.flagState;
+        this->delayIme = registers.delayIme; this->halted = registers.halted; this->haltBug = registers.haltBug;
+        this->idleLoop = registers.idleLoop; this->idleLoopStats = registers.idleLoopStats;
+        this->interrupts.ime = registers.ime; this->interrupts.flag = registers.flag; this->interrupts.enable = registers.enable;
+        this->scheduler.now = registers.now;
+    };
+
+    // WRAM, VRAM, OAM, HRAM, then the mapped cart RAM bank
+    struct Region
+    {
+        u8* data;
+        u16 size;
+    };
+
+    // Asked of the cart rather than the write table, which has no pointer for a .sav page that
+    // hasn't been written since its last flush
+    u8* cartRAM = this->bus.cart.mapRAM(0xA000);
+
+    const Region regions[] =
+    {
+        {this->bus.wram, sizeof(this->bus.wram)},
+        {this->bus.vram, sizeof(this->bus.vram)},
+        {this->bus.oam, sizeof(this->bus.oam)},
+        {this->bus.hram, sizeof(this->bus.hram)},
+        {cartRAM, static_cast<u16>(cartRAM ? 0x2000 : 0)},
+    };
+
+    this->lockstepMemory.resize(0x2000 * 3 + 0x100 * 2);
+
+    const Registers before = save();
+
+    u8* memory = this->lockstepMemory.data();
+    for(const Region& region : regions)
+    {
+        memcpy(memory, region.data, region.size);
+        memory += region.size;
+    }
+
+    const u8* pages[0x40];
+    memcpy(pages, &this->bus.readPages[0x40], sizeof(pages));
+
+    block.compiled(this, &this->scheduler.now);
+
+    if(memcmp(pages, &this->bus.readPages[0x40], sizeof(pages)) != 0 || this->bus.cart.mapRAM(0xA000) != cartRAM)
+        return;
+
+    this->syncFlags();
+    const Registers compiled = save();
+
+    restore(before);
+
+    memory = this->lockstepMemory.data();
+    for(const Region& region : regions)
+    {
+        memcpy(region.data, memory, region.size);
+        memory += region.size;
+    }
+
+    while(this->scheduler.now < compiled.now)
+    {
+        if(this->interrupts.check(*this))
+            this->scheduler.now += 20;
+        else
+            this->scheduler.now += this->step();
+    }
+
+    this->syncFlags();
+
+    const Registers interpreted = save();
+
+    ++this->jitStats.checks;
+
+    const bool matches = interpreted.af.pair == compiled.af.pair && interpreted.bc.pair == compiled.bc.pair && interpreted.de.pair == compiled.de.pair && interpreted.hl.pair == compiled.hl.pair && interpreted.sp == compiled.sp && interpreted.pc == compiled.pc && interpreted.now == compiled.now && interpreted.ime == compiled.ime && interpreted.halted == compiled.halted;
+
+    if(!matches)
+    {
+        ++this->jitStats.mismatches;
+
+        #ifdef ERROR
+            this->errors.reportError(std::format("JIT_LOCKSTEP_MISMATCH {:X}\n", block.pc), ErrorModule::CPU);
+        #endif
+    }
+}
+
+#endif
+
 // =================================================================================
 // Main Logic
 // =================================================================================
@@ -1166,17 +1854,71 @@ u8 CPU::executeExtendedOpcode(const u8 opcode)
 u8 CPU::step()
 {
     if(this->halted)
-        return 4;
+    {
+        // A pending enabled interrupt ends HALT even with IME clear, it just isn't serviced
+        if(!(this->interrupts.flag & this->interrupts.enable & 0x1F))
+            return 4;
 
-    const u8 opcode = this->fetchByte();
+        this->halted = false;
+    }
 
+    if(this->delayIme)
+    {
+        this->interrupts.ime = true;
+        this->delayIme = false;
+    }
+
+    const u8 opcode = this->bus.readByte(this->pc);
+    u16 addr = this->pc + 1;
+
+    // The HALT bug fails to increment PC, the opcode byte is read again as the first operand
     if(this->haltBug)
     {
-        --this->pc;
+        --addr;
         this->haltBug = false;
     }
 
+    const u8 length = Opcodes::base[opcode].length;
+
+    if(length == 3)
+        this->operand = this->bus.readWord(addr);
+    else if(length == 2)
+        this->operand = this->bus.readByte(addr);
+
+    this->pc = addr + length - 1;
+
     const u8 cycles = this->executeOpcode(opcode);
 
     return cycles;
+}
+
+void CPU::run()
+{
+    while(this->scheduler.now < this->scheduler.deadline)
+    {
+        u8 cycles;
+
+        bool interrupted = this->interrupts.check(*this);
+        if(interrupted)
+        {
+            cycles = 20;
+        }
+        else if(this->halted && !(this->interrupts.flag & this->interrupts.enable & 0x1F))
+        {
+            // Nothing can wake the CPU before the next event, skip straight to it in whole 4-cycle steps
+            this->scheduler.now += (this->scheduler.deadline - this->scheduler.now + 3) & ~u64(3);
+            continue;
+        }
+        else if(this->halted || this->delayIme || this->haltBug)
+        {
+            cycles = this->step();
+        }
+        else
+        {
+            this->runBlock();
+            continue;
+        }
+
+        this->scheduler.now += cycles;
+    }
 }
\ No newline at end of file
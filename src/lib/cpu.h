@@ -1,11 +1,22 @@
 #pragma once
 
+#include <vector>
+#include <memory>
 #include "types.h"
+#include "state.h"
+#include "options.h"
 #include "bus.h"
 #include "interrupts.h"
+#include "scheduler.h"
+
+class JIT;
+class ErrorCollector;
 
 class CPU
 {
+    public:
+        using CompiledBlock = void (*)(CPU* cpu, u64* now);
+
     private:
         enum class Flag : u8
         {
@@ -15,6 +26,31 @@ class CPU
             C = 0x10,
         };
 
+        // The last flag-setting operation, kept so that flags can be computed on demand
+        enum class FlagOp : u8
+        {
+            None,   // af.lo is up to date
+            Add,    // ADD/ADC: lhs + rhs + carry
+            Sub,    // SUB/SBC/CP: lhs - rhs - carry
+            Inc,
+            Dec,
+            And,
+            Logic,  // OR/XOR/SWAP: only Z depends on the result
+            Shift,  // Rotates and shifts, carry is the bit shifted out
+            ShiftA, // RLCA/RRCA/RLA/RRA, like Shift but Z is always clear
+            Bit,
+        };
+
+        struct FlagState
+        {
+            FlagOp op;
+            u8 lhs;
+            u8 rhs;
+            u8 carry;
+            u16 result;
+            u8 preserved; // Flags the operation leaves untouched
+        };
+
         enum class ConditionCode : u8
         {
             None,
@@ -42,6 +78,61 @@ class CPU
         u16 sp;
         u16 pc;
 
+        FlagState flagState;
+
+        // The innermost loop last closed by a backward JR, tracked to spot busy-wait loops
+        struct IdleLoop
+        {
+            u16 start;
+            u16 branch;
+            bool idle;      // The body only reads memory the scheduler can predict
+            u16 maxPeriod;  // Longest an iteration of the body can take
+            u64 timestamp;  // Cycle the branch was last taken
+            u64 deadline;   // Scheduler deadline at that time, an event ran in between if it moved
+            u64 period;     // Cycles between the last two visits if the registers were unchanged
+            u16 registers[5];
+        };
+
+        IdleLoop idleLoop;
+
+        // Immediate operand of the executing instruction, read when it is decoded
+        u16 operand;
+
+        // A straight run of pre-decoded instructions ending at a control transfer or the page end
+        struct DecodedInstruction
+        {
+            u8 opcode;
+            u8 length;
+            u16 operand;
+        };
+
+        static constexpr u8 maxBlockInstructions = 12;
+        static constexpr u16 blockCacheSize = 2048;
+        static constexpr u8 romRegion = 0xFF;
+
+        struct Block
+        {
+            const u8* code;     // Host address of the first opcode, distinguishes ROM banks and the boot ROM
+            const u8* page;     // Host page the block was decoded from
+            u16 pc;
+            u8 region;          // WRAM page for invalidation, or romRegion for code that never changes
+            u8 count;
+            u32 generation;
+            DecodedInstruction instructions[maxBlockInstructions];
+
+            #ifdef CPU_JIT
+                u16 maxCycles;              // Upper bound of the cycles the whole block takes
+                u16 hits;
+                CompiledBlock compiled;
+            #endif
+        };
+
+        // Direct-mapped on the host address
+        std::vector<Block> blocks;
+
+        // Bumped whenever a WRAM page holding decoded code is written
+        u32 codeGenerations[0x20];
+
         bool delayIme;
 
         bool halted;
@@ -49,15 +140,29 @@ class CPU
 
         Interrupts& interrupts;
         Bus& bus;
+        Scheduler& scheduler;
+
+        const Options& options;
+        ErrorCollector& errors;
 
         friend class GameBoy;
         friend class Interrupts;
+        friend class OpcodeBench;
+        friend class JIT;
 
         void setFlag(Flag flag, const bool val);
         bool getFlag(Flag flag) const;
 
+        static u8 computeFlags(const FlagState& state);
+        void setFlags(const FlagOp op, const u8 lhs, const u8 rhs, const u8 carry, const u16 result);
+        void syncFlags();
+
         bool isConditionTrue(ConditionCode conditionCode) const;
 
+        bool isIdleLoopBody(const u16 start, const u16 end, u16& maxPeriod) const;
+        void checkIdleLoop(const u16 branch);
+        void forgetIdleLoop();
+
         u8 fetchByte();
         u16 fetchWord();
 
@@ -130,10 +235,12 @@ class CPU
 
         // -------- Control Flow -------------
 
-        void JP(const u16 addr, ConditionCode conditionCode);
-        void JR(const i8 offset, ConditionCode conditionCode);
-        void CALL(const u16 addr, ConditionCode conditionCode);
-        void RET(ConditionCode conditionCode, bool fromInterruptHandler);
+        // Return true if the branch was taken
+
+        bool JP(const u16 addr, ConditionCode conditionCode);
+        bool JR(const i8 offset, ConditionCode conditionCode);
+        bool CALL(const u16 addr, ConditionCode conditionCode);
+        bool RET(ConditionCode conditionCode, bool fromInterruptHandler);
         void RST(const u16 vec);
 
         // -------- Misc ---------------------
@@ -143,13 +250,88 @@ class CPU
         void DI();
         void EI();
 
+        // -------- Dispatch -----------------
+
+        using Handler = u8 (CPU::*)();
+        using ThreadedHandler = u8 (*)(CPU& cpu);
+
+        u8 execute(const u8 opcode);
+        u8 executeExtended(const u8 opcode);
+
+        template<u8 Opcode> u8 handler();
+        template<u8 Opcode> u8 extendedHandler();
+        template<u8 Opcode> static u8 threadedHandler(CPU& cpu);
+        template<u8 Opcode> static u8 threadedExtendedHandler(CPU& cpu);
+
         u8 executeOpcode(const u8 opcode);
         u8 executeExtendedOpcode(const u8 opcode);
+
+        // -------- Block Cache --------------
+
+        static bool endsBlock(const u8 opcode);
+
+        Block* getBlock();
+        bool decodeBlock(Block& block, const u8* page, const u8 region);
+        void runBlock();
+
+        // -------- JIT ----------------------
+
+        #ifdef CPU_JIT
+            // Executions of a ROM block before it is compiled
+            static constexpr u16 jitThreshold = 32;
+
+            std::unique_ptr<JIT> jit;
+
+            // Machine state saved before a block runs in lockstep mode
+            std::vector<u8> lockstepMemory;
+
+            static ThreadedHandler getThreadedHandler(const u8 opcode, const bool extended);
+
+            // Called by compiled code after memory accesses
+            static bool shouldExitCompiledBlock(CPU* cpu, const u32 remaining, const u8* page);
+
+            void resetJIT();
+            bool runCompiledBlock(Block& block);
+            void runLockstep(Block& block);
+        #endif
     
     public:
-        CPU(Bus& bus, Interrupts& interrupts);
+        struct IdleLoopStats
+        {
+            u64 loops;  // Times a busy-wait loop was fast-forwarded
+            u64 cycles; // Cycles skipped in total
+        };
+
+        IdleLoopStats idleLoopStats;
+
+        #ifdef CPU_JIT
+            struct JITStats
+            {
+                u64 blocks;     // Blocks compiled
+                u64 checks;     // Blocks compared against the interpreter in lockstep mode
+                u64 mismatches; // Compared blocks that ended in a different state
+            };
+
+            JITStats jitStats;
+        #endif
+
+        CPU(Bus& bus, Interrupts& interrupts, Scheduler& scheduler, const Options& options, ErrorCollector& errors);
+        ~CPU();
 
         void restart();
 
+        // Decoded WRAM blocks are dropped on load, ROM blocks stay valid
+        void saveState(StateWriter& state) const;
+        void loadState(StateReader& state);
+
+        // Drop every decoded block, for when ROM or boot ROM contents are replaced
+        void flushBlockCache();
+
+        // Called by the bus on the first write to a WRAM page that decoded code was read from
+        void invalidateCodePage(const u8 page);
+
         u8 step();
+
+        // Service interrupts and execute instructions until the scheduler's deadline
+        void run();
 };
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "decode.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+    #define DECODE_X86
+    #include <immintrin.h>
+#endif
+
+namespace Decode
+{
+    // =================================================================================
+    // Scalar
+    // =================================================================================
+
+    static void rowsScalar(const u8* planes, u8* pixels, const u32 count)
+    {
+        for(u32 row = 0; row < count; ++row)
+        {
+            const u8 lowByte = planes[row * 2];
+            const u8 highByte = planes[row * 2 + 1];
+
+            for(u8 pixel = 0; pixel < 8; ++pixel)
+            {
+                const u8 lowBit = (lowByte >> (7 - pixel)) & 1;
+                const u8 highBit = (highByte >> (7 - pixel)) & 1;
+                pixels[row * 8 + pixel] = (highBit << 1) | lowBit;
+            }
+        }
+    }
+
+    static void paletteScalar(const u8* indices, u8* out, const u32 count, const u8 shades[4])
+    {
+        for(u32 i = 0; i < count; ++i)
+        {
+            out[i] = shades[indices[i] & 0x3];
+        }
+    }
+
+    #ifdef DECODE_X86
+
+    // =================================================================================
+    // SSE2 / SSSE3
+    // =================================================================================
+
+    // Two rows per vector: broadcast each plane byte to 8 lanes, test one bit per lane (MSB first)
+    __attribute__((target("sse2")))
+    static void rowsSSE2(const u8* planes, u8* pixels, const u32 count)
+    {
+        const __m128i bits = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        const __m128i one = _mm_set1_epi8(1);
+        const u64 broadcast = 0x0101010101010101;
+
+        u32 row = 0;
+        for(; row + 2 <= count; row += 2)
+        {
+            const __m128i low = _mm_set_epi64x(planes[row * 2 + 2] * broadcast, planes[row * 2] * broadcast);
+            const __m128i high = _mm_set_epi64x(planes[row * 2 + 3] * broadcast, planes[row * 2 + 1] * broadcast);
+
+            const __m128i lowBits = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(low, bits), bits), one);
+            const __m128i highBits = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(high, bits), bits), one);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&pixels[row * 8]), _mm_or_si128(lowBits, _mm_add_epi8(highBits, highBits)));
+        }
+
+        rowsScalar(&planes[row * 2], &pixels[row * 8], count - row);
+    }
+
+    __attribute__((target("ssse3")))
+    static void paletteSSSE3(const u8* indices, u8* out, const u32 count, const u8 shades[4])
+    {
+        const __m128i table = _mm_setr_epi8(shades[0], shades[1], shades[2], shades[3], 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+        u32 i = 0;
+        for(; i + 16 <= count; i += 16)
+        {
+            const __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&indices[i]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&out[i]), _mm_shuffle_epi8(table, index));
+        }
+
+        paletteScalar(&indices[i], &out[i], count - i, shades);
+    }
+
+    // =================================================================================
+    // AVX2 / BMI2
+    // =================================================================================
+
+    // pdep scatters the 8 plane bits into the low bit of 8 bytes (LSB first), the byte swap puts the leftmost pixel first
+    __attribute__((target("bmi2")))
+    static void rowsBMI2(const u8* planes, u8* pixels, const u32 count)
+    {
+        for(u32 row = 0; row < count; ++row)
+        {
+            const u64 low = _pdep_u64(planes[row * 2], 0x0101010101010101);
+            const u64 high = _pdep_u64(planes[row * 2 + 1], 0x0202020202020202);
+            const u64 row64 = __builtin_bswap64(low | high);
+
+            __builtin_memcpy(&pixels[row * 8], &row64, 8);
+        }
+    }
+
+    __attribute__((target("avx2")))
+    static void paletteAVX2(const u8* indices, u8* out, const u32 count, const u8 shades[4])
+    {
+        const __m256i table = _mm256_setr_epi8(shades[0], shades[1], shades[2], shades[3], 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                               shades[0], shades[1], shades[2], shades[3], 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+        u32 i = 0;
+        for(; i + 32 <= count; i += 32)
+        {
+            const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&indices[i]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(&out[i]), _mm256_shuffle_epi8(table, index));
+        }
+
+        paletteScalar(&indices[i], &out[i], count - i, shades);
+    }
+
+    #endif
+
+    // =================================================================================
+    // Dispatch
+    // =================================================================================
+
+    using RowsFunction = void (*)(const u8* planes, u8* pixels, const u32 count);
+    using PaletteFunction = void (*)(const u8* indices, u8* out, const u32 count, const u8 shades[4]);
+
+    static Path path = Path::Scalar;
+    static RowsFunction rowsFunction = rowsScalar;
+    static PaletteFunction paletteFunction = paletteScalar;
+
+    static bool isSupported(Path path)
+    {
+        switch(path)
+        {
+            #ifdef DECODE_X86
+                case Path::SSE2:
+                    return __builtin_cpu_supports("sse2");
+                case Path::AVX2:
+                    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2");
+            #endif
+            case Path::Scalar:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool setPath(Path newPath)
+    {
+        if(!isSupported(newPath))
+            return false;
+
+        path = newPath;
+
+        switch(path)
+        {
+            #ifdef DECODE_X86
+                case Path::SSE2:
+                    rowsFunction = rowsSSE2;
+                    paletteFunction = __builtin_cpu_supports("ssse3") ? paletteSSSE3 : paletteScalar;
+                    break;
+                case Path::AVX2:
+                    rowsFunction = rowsBMI2;
+                    paletteFunction = paletteAVX2;
+                    break;
+            #endif
+            default:
+                rowsFunction = rowsScalar;
+                paletteFunction = paletteScalar;
+                break;
+        }
+
+        return true;
+    }
+
+    Path getPath()
+    {
+        return path;
+    }
+
+    static bool detectPath()
+    {
+        // Runs from a static initializer, possibly before libgcc has filled in the cpuid data
+        // __builtin_cpu_supports reads
+        #ifdef DECODE_X86
+            __builtin_cpu_init();
+        #endif
+
+        return setPath(Path::AVX2) || setPath(Path::SSE2) || setPath(Path::Scalar);
+    }
+
+    [[maybe_unused]] static const bool detected = detectPath();
+
+    void rows(const u8* planes, u8* pixels, const u32 count)
+    {
+        rowsFunction(planes, pixels, count);
+    }
+
+    void palette(const u8* indices, u8* out, const u32 count, const u8 shades[4])
+    {
+        paletteFunction(indices, out, count, shades);
+    }
+};
\ No newline at end of file
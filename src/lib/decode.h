@@ -0,0 +1,28 @@
+#pragma once
+
+#include "types.h"
+
+// Tile row decoding and palette mapping for the PPU. The implementation is picked once at
+// startup from the best instruction set extension the host CPU supports.
+namespace Decode
+{
+    enum class Path : u8
+    {
+        Scalar,
+        SSE2,   // SSE2 bit expansion, SSSE3 palette shuffle when available
+        AVX2,   // BMI2 pdep bit expansion, AVX2 palette shuffle
+    };
+
+    // Expand count 2bpp tile rows, stored as low/high bitplane byte pairs, into 8 color indices each, leftmost pixel first
+    void rows(const u8* planes, u8* pixels, const u32 count);
+
+    // Map count color indices through a 4-entry palette
+    void palette(const u8* indices, u8* out, const u32 count, const u8 shades[4]);
+
+    Path getPath();
+
+    // Override the detected path, returns false if the host does not support it. Every GameBoy
+    // in the process reads the path while rendering, so only call this while none is running
+    // (before starting a BatchRunner, not during run), or it is a data race.
+    bool setPath(Path path);
+};
@@ -6,18 +6,28 @@ Error::Error( const std::string& text, const ErrorModule& module) : text(text),
 
 void ErrorCollector::reportError(const std::string& text, const ErrorModule& module)
 {
-    ErrorCollector::errors.push_back(Error{text, module});
+    this->errors.push_back(Error{text, module});
 }
 
 void ErrorCollector::reportFatalError(const std::string& text, const ErrorModule& module)
 {
-    ErrorCollector::reportError(text, module);
-    ErrorCollector::printErrors(true);
+    this->reportError(text, module);
+    this->printErrors(true);
 }
 
-void ErrorCollector::printErrors(bool release)
+const std::vector<Error>& ErrorCollector::getErrors() const
 {
-    for(auto& error : ErrorCollector::errors)
+    return this->errors;
+}
+
+void ErrorCollector::clear()
+{
+    this->errors.clear();
+}
+
+void ErrorCollector::printErrors(bool release) const
+{
+    for(auto& error : this->errors)
     {
         std::string message = "\x1B[31m--> ERROR";
         switch(error.module)
@@ -25,12 +25,18 @@ struct Error
     Error(const std::string& text, const ErrorModule& module);
 };
 
-namespace ErrorCollector
+// Errors of one GameBoy, its components report to the collector it owns
+class ErrorCollector
 {
-    void reportError(const std::string& text, const ErrorModule& module);
-    void reportFatalError(const std::string& text, const ErrorModule& module);
+    private:
+        std::vector<Error> errors;
 
-    void printErrors(bool release);
+    public:
+        void reportError(const std::string& text, const ErrorModule& module);
+        void reportFatalError(const std::string& text, const ErrorModule& module);
 
-    static std::vector<Error> errors;
+        void printErrors(bool release) const;
+
+        const std::vector<Error>& getErrors() const;
+        void clear();
 };
@@ -1,19 +1,25 @@
 #include "gameboy.h"
 
-// #include <ncurses.h>
+#include <string.h>
+#include <chrono>
+#include <filesystem>
 
-#ifdef ERROR
-    #include "error.h"
-#endif
+// #include <ncurses.h>
 
-bool GameBoy::skipBootROM = false;
-GameBoy::GameBoy() : bus(this->cart, this->cpu, this->timer, this->ppu, this->joypad, this->interrupts), cpu(this->bus, this->interrupts), timer(this->bus, this->interrupts), ppu(this->bus, this->interrupts), joypad(this->bus, this->interrupts) 
+GameBoy::GameBoy(const Options& options) : options(options), bus(this->cart, this->cpu, this->timer, this->ppu, this->joypad, this->interrupts, this->options, this->errors), cart(this->errors), cpu(this->bus, this->interrupts, this->scheduler, this->options, this->errors), timer(this->bus, this->interrupts, this->scheduler, this->options), ppu(this->bus, this->interrupts, this->scheduler, this->options), joypad(this->bus, this->interrupts, this->options), interrupts(this->options), runAheadStats({0, 0, 0, 0})
 { 
 
 }
 
-void GameBoy::reboot()
+bool GameBoy::reboot()
 {
+    // Opened before anything is reset, the file may have been removed or replaced since it was loaded
+    std::shared_ptr<const ROMImage> image = this->openROM(this->romPath);
+
+    if(!image)
+        return false;
+
+    this->scheduler.restart();
     this->bus.restart();
     this->cpu.restart();
     this->ppu.restart();
@@ -22,15 +28,17 @@ void GameBoy::reboot()
     this->cart.restart();
     this->joypad.restart();
 
-    if(!GameBoy::skipBootROM)
+    if(!this->options.skipBootROM)
         this->loadBootROM(this->bootROMPath);
 
-    this->loadROM(this->romPath);
+    this->insertROM(this->romPath, std::move(image));
+
+    return true;
 }
 
-std::array<u8, 160 * 144 * 3>& GameBoy::getFramebuffer()
+std::span<const u8> GameBoy::getFramebuffer(PPU::PixelFormat format)
 {
-    return this->ppu.framebuffer;
+    return this->ppu.getFramebuffer(format);
 }
 
 std::string GameBoy::getTitle()
@@ -45,6 +53,143 @@ std::string GameBoy::getTitle()
     return title;
 }
 
+const ErrorCollector& GameBoy::getErrors() const
+{
+    return this->errors;
+}
+
+CPU::IdleLoopStats GameBoy::getIdleLoopStats()
+{
+    return this->cpu.idleLoopStats;
+}
+
+#ifdef CPU_JIT
+    CPU::JITStats GameBoy::getJITStats()
+    {
+        return this->cpu.jitStats;
+    }
+#endif
+
+// =================================================================================
+// Save States
+// =================================================================================
+
+GameBoy::StateHeader GameBoy::getStateHeader() const
+{
+    StateHeader header;
+    header.magic = GameBoy::stateMagic;
+    header.version = GameBoy::stateVersion;
+    header.cartType = static_cast<u8>(this->cart.type);
+    header.ramBanks = this->cart.ramBanks;
+    header.romBanks = this->cart.romBanks;
+    header.globalChecksum = this->cart.rom ? (this->cart.rom[0x14E] << 8) | this->cart.rom[0x14F] : 0;
+    header.size = 0;
+
+    return header;
+}
+
+void GameBoy::writeState(StateWriter& state) const
+{
+    this->scheduler.saveState(state);
+    this->cpu.saveState(state);
+    this->interrupts.saveState(state);
+    this->timer.saveState(state);
+    this->ppu.saveState(state);
+    this->joypad.saveState(state);
+    this->bus.saveState(state);
+    this->cart.saveState(state);
+}
+
+size_t GameBoy::getStateSize() const
+{
+    StateWriter counter{std::span<u8>()};
+    counter.write(this->getStateHeader());
+    this->writeState(counter);
+
+    return counter.getSize();
+}
+
+size_t GameBoy::saveState(std::span<u8> buffer) const
+{
+    StateHeader header = this->getStateHeader();
+    header.size = this->getStateSize();
+
+    if(buffer.size() < header.size)
+    {
+        #ifdef ERROR
+            this->errors.reportError("SAVE_STATE_BUFFER_TOO_SMALL", ErrorModule::GameBoy);
+        #endif
+        return 0;
+    }
+
+    StateWriter state(buffer);
+    state.write(header);
+    this->writeState(state);
+
+    return state.getSize();
+}
+
+bool GameBoy::loadState(std::span<const u8> state)
+{
+    StateHeader expected = this->getStateHeader();
+    expected.size = this->getStateSize();
+
+    StateReader reader(state);
+    StateHeader header;
+    reader.read(header);
+
+    // Validated up front so that no component reads past the end and the load can't fail halfway
+    if(reader.isOverflowed() || header != expected || state.size() < expected.size)
+    {
+        #ifdef ERROR
+            this->errors.reportError("INCOMPATIBLE_SAVE_STATE", ErrorModule::GameBoy);
+        #endif
+        return false;
+    }
+
+    this->scheduler.loadState(reader);
+    this->cpu.loadState(reader);
+    this->interrupts.loadState(reader);
+    this->timer.loadState(reader);
+    this->ppu.loadState(reader);
+    this->joypad.loadState(reader);
+    this->bus.loadState(reader);
+    this->cart.loadState(reader);
+
+    // The cart pages depend on the MBC registers and the boot ROM flag
+    this->bus.remap();
+
+    return true;
+}
+
+// =================================================================================
+// Rewind
+// =================================================================================
+
+void GameBoy::setRewind(const u16 interval, const size_t capacity)
+{
+    if(interval)
+        this->history = std::make_unique<Rewind>(interval, capacity);
+    else
+        this->history.reset();
+}
+
+bool GameBoy::rewind()
+{
+    if(!this->history)
+        return false;
+
+    return this->history->rewind(*this);
+}
+
+Rewind::Stats GameBoy::getRewindStats()
+{
+    if(!this->history)
+        return {0, 0, 0, 0};
+
+    return this->history->getStats();
+}
+
 void GameBoy::pressButton(Joypad::Button button)
 {
     this->joypad.pressButton(button);
@@ -64,24 +209,24 @@ void GameBoy::loadBootROM(std::string path)
     if(!file)
     {
         #ifdef ERROR
-            ErrorCollector::reportError("COULD_NOT_OPEN_BOOT_ROM_FILE", ErrorModule::GameBoy);
+            this->errors.reportError("COULD_NOT_OPEN_BOOT_ROM_FILE", ErrorModule::GameBoy);
         #endif
-        GameBoy::skipBootROM = true;
+        this->options.skipBootROM = true;
         this->reboot();
         return;
     }
 
     fseek(file, 0, SEEK_END);
     size_t size = ftell(file);
-    rewind(file);
+    ::rewind(file);
 
     if(size != 256)
     {
         #ifdef ERROR
-            ErrorCollector::reportError("INCOMPATIBLE_BOOT_ROM", ErrorModule::GameBoy);
+            this->errors.reportError("INCOMPATIBLE_BOOT_ROM", ErrorModule::GameBoy);
         #endif
         fclose(file);
-        GameBoy::skipBootROM = true;
+        this->options.skipBootROM = true;
         this->reboot();
         return;
     }
@@ -89,80 +234,206 @@ void GameBoy::loadBootROM(std::string path)
     if(fread(this->bus.bootRom, sizeof(u8), size, file) != size)
     {
         #ifdef ERROR
-            ErrorCollector::reportError("COULD_NOT_LOAD_BOOT_ROM_FROM_FILE", ErrorModule::GameBoy);
+            this->errors.reportError("COULD_NOT_LOAD_BOOT_ROM_FROM_FILE", ErrorModule::GameBoy);
         #endif
         fclose(file);
-        GameBoy::skipBootROM = true;
+        this->options.skipBootROM = true;
         this->reboot();
         return;
     }
 
     fclose(file);
+    this->cpu.flushBlockCache();
 }
 
-void GameBoy::loadROM(std::string path)
+bool GameBoy::loadROM(std::string path)
 {
-    this->romPath = path;
+    std::shared_ptr<const ROMImage> image = this->openROM(path);
 
-    FILE* file = fopen(path.c_str(), "rb");
+    if(!image)
+        return false;
 
-    if(!file)
+    this->insertROM(path, std::move(image));
+
+    return true;
+}
+
+std::shared_ptr<const ROMImage> GameBoy::openROM(const std::string& path)
+{
+    std::shared_ptr<const ROMImage> image = ROMImage::open(path);
+
+    if(!image)
     {
         #ifdef ERROR
-            ErrorCollector::reportFatalError("COULD_NOT_OPEN_ROM_FILE", ErrorModule::GameBoy);
+            this->errors.reportFatalError("COULD_NOT_OPEN_ROM_FILE", ErrorModule::GameBoy);
         #endif
+        return nullptr;
     }
 
-    fseek(file, 0, SEEK_END);
-    size_t size = ftell(file);
-    rewind(file);
+    if(image->getFileSize() < ROMImage::headerEnd)
+    {
+        #ifdef ERROR
+            this->errors.reportFatalError("ROM_FILE_HAS_NO_HEADER", ErrorModule::GameBoy);
+        #endif
+        return nullptr;
+    }
+
+    if(!Cart::isSupported(image->getData()[0x147]))
+    {
+        #ifdef ERROR
+            this->errors.reportFatalError("UNIMPLEMENTED_MBC", ErrorModule::GameBoy);
+        #endif
+        return nullptr;
+    }
 
-    std::unique_ptr<u8[]> buffer = std::make_unique<u8[]>(size);
+    const auto romBanks = this->cart.romBanksLookupTable.find(image->getData()[0x148]);
+    const auto ramBanks = this->cart.ramBanksLookupTable.find(image->getData()[0x149]);
 
-    if(fread(buffer.get(), sizeof(u8), size, file) != size)
+    if(romBanks == this->cart.romBanksLookupTable.end() || ramBanks == this->cart.ramBanksLookupTable.end())
     {
         #ifdef ERROR
-            ErrorCollector::reportFatalError("COULD_NOT_LOAD_ROM_FROM_FILE", ErrorModule::GameBoy);
+            this->errors.reportFatalError("INVALID_ROM_OR_RAM_SIZE_IN_HEADER", ErrorModule::GameBoy);
         #endif
-        fclose(file);
-        return;
+        return nullptr;
     }
 
-    fclose(file);
-    this->cart.type = static_cast<Cart::Type>(buffer[0x147]);
+    // Only a file shorter than the banks its header declares is copied, and the padded copy
+    // replaces the mapping in the cache for the instances loading it after this one
+    const size_t romSize = romBanks->second * 0x4000;
+
+    if(image->getSize() < romSize)
+    {
+        image = ROMImage::open(path, romSize);
+
+        if(!image)
+        {
+            #ifdef ERROR
+                this->errors.reportFatalError("COULD_NOT_LOAD_ROM_FROM_FILE", ErrorModule::GameBoy);
+            #endif
+            return nullptr;
+        }
+    }
+
+    // Real carts boot with a wrong global checksum, and so does this without the boot ROM
+    #ifdef ERROR
+        if(!image->isHeaderChecksumValid())
+            this->errors.reportError("INVALID_HEADER_CHECKSUM", ErrorModule::GameBoy);
+
+        if(!image->isGlobalChecksumValid())
+            this->errors.reportError("INVALID_GLOBAL_CHECKSUM", ErrorModule::GameBoy);
+    #endif
+
+    return image;
+}
+
+void GameBoy::insertROM(const std::string& path, std::shared_ptr<const ROMImage> image)
+{
+    this->romPath = path;
+
+    this->cart.type = static_cast<Cart::Type>(image->getData()[0x147]);
+    this->cart.romBanks = this->cart.romBanksLookupTable.at(image->getData()[0x148]);
+    this->cart.ramBanks = this->cart.ramBanksLookupTable.at(image->getData()[0x149]);
+
+    this->cart.image = std::move(image);
+    this->cart.rom = this->cart.image->getData();
+    this->cart.createRAM(this->options.batterySaves ? std::filesystem::path(path).replace_extension(".sav").string() : "");
     this->cart.createMBC();
 
-    this->cart.romBanks = this->cart.romBanksLookupTable.at(buffer[0x148]);
-    this->cart.ramBanks = this->cart.ramBanksLookupTable.at(buffer[0x149]);
+    this->bus.remap();
+    this->cpu.flushBlockCache();
 
-    this->cart.rom = std::make_unique<u8[]>(this->cart.romBanks * 0x4000);
-    this->cart.rom.swap(buffer);
-    this->cart.ram = std::make_unique<u8[]>(this->cart.ramBanks * 0x2000);
-    memset(this->cart.ram.get(), 0, sizeof(*this->cart.ram.get()));
+    if(this->history)
+        this->history->clear();
 }
 
 void GameBoy::step()
 {
-    u32 cycleCounter = 0;
+    this->runFrame();
 
-    while(cycleCounter < 69905) // 4,194,304 Hz clock / 60 Hz refresh rate -> The actual refresh rate is 59.73 Hz but emulators run slowly
-    {
-        u8 cycles;
+    // Flushing cleans the save file's pages, the bus has to catch the next write to each again
+    if(this->cart.saveFile && this->cart.saveFile->frame())
+        this->bus.remap();
 
-        bool interrupted = this->interrupts.check(this->cpu);
-        if(!interrupted)
-            cycles = this->cpu.step();
-        else
-            cycles = 20;
-    
-        cycleCounter += cycles;
+    if(this->history)
+        this->history->frame(*this);
+}
 
-        this->timer.step(cycles);
+void GameBoy::runFrame()
+{
+    // 4,194,304 Hz clock / 60 Hz refresh rate -> The actual refresh rate is 59.73 Hz but emulators run slowly
+    const u64 frameEnd = this->scheduler.now + 69905;
+    this->scheduler.setLimit(frameEnd);
 
-        this->ppu.step(cycles);
+    while(this->scheduler.now < frameEnd)
+    {
+        this->cpu.run();
+
+        Scheduler::Event event;
+        while(this->scheduler.popDue(event))
+        {
+            switch(event)
+            {
+                case Scheduler::Event::PPU:
+                    this->ppu.step();
+                    break;
+                case Scheduler::Event::Timer:
+                    this->timer.step();
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
 
-        this->joypad.checkButtons();
+void GameBoy::runAhead(const u8 frames)
+{
+    if(!frames)
+    {
+        this->step();
+        return;
     }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // The frame that counts, nothing it draws would be shown
+    this->ppu.render = false;
+    this->step();
+
+    const auto saveStart = std::chrono::steady_clock::now();
+    this->runAheadState.resize(this->getStateSize());
+    this->saveState(this->runAheadState);
+    const auto saveEnd = std::chrono::steady_clock::now();
+
+    // Cart RAM writes of these frames land in a mapped .sav like any others, and the kernel or the
+    // flush worker may write them out before the rollback. Rolling back copies back the pages
+    // they changed and marks them dirty again, so the file holds the real frame's RAM by the
+    // next flush at the latest.
+    for(u8 i = 1; i < frames; ++i)
+        this->runFrame();
+
+    // A whole frame of scanlines, so every visible line is drawn once
+    this->ppu.render = true;
+    this->runFrame();
+    this->runAheadFramebuffer = this->ppu.framebuffer;
+
+    const auto loadStart = std::chrono::steady_clock::now();
+    this->loadState(this->runAheadState);
+    const auto loadEnd = std::chrono::steady_clock::now();
+
+    this->ppu.framebuffer = this->runAheadFramebuffer;
+
+    const auto nanoseconds = [](const auto duration) { return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()); };
+
+    ++this->runAheadStats.frames;
+    this->runAheadStats.saveNanoseconds += nanoseconds(saveEnd - saveStart);
+    this->runAheadStats.loadNanoseconds += nanoseconds(loadEnd - loadStart);
+    this->runAheadStats.totalNanoseconds += nanoseconds(loadEnd - start);
+}
+
+GameBoy::RunAheadStats GameBoy::getRunAheadStats()
+{
+    return this->runAheadStats;
 }
 
 // void GameBoy::createGameBoyDoctorLog()
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "types.h"
+#include <array>
+#include <vector>
+#include "state.h"
 #include "string"
 
+#include "scheduler.h"
 #include "bus.h"
 #include "cart.h"
 #include "cpu.h"
@@ -10,13 +14,32 @@
 #include "ppu.h"
 #include "joypad.h"
 #include "interrupts.h"
+#include "rewind.h"
+#include "options.h"
+#include "error.h"
 
 class GameBoy
 {
+    public:
+        struct RunAheadStats
+        {
+            u64 frames;             // Frames shown from run-ahead
+            u64 saveNanoseconds;    // Spent saving the state to roll back to
+            u64 loadNanoseconds;    // Spent rolling back
+            u64 totalNanoseconds;   // Spent in runAhead altogether
+        };
+
+        // Read by the components on every use, so changes take effect immediately or on the next reboot
+        Options options;
+
     private:
+        // Reported to from const members too, like saveState
+        mutable ErrorCollector errors;
+
         std::string bootROMPath;
         std::string romPath;
 
+        Scheduler scheduler;
         Bus bus;
         Cart cart;
         CPU cpu;
@@ -25,24 +48,98 @@ class GameBoy
         Joypad joypad;
         Interrupts interrupts;
 
-    public:
-        static bool skipBootROM;
+        friend class MBCBench;
+
+        std::unique_ptr<Rewind> history;
+
+        // Reused by runAhead so that it doesn't allocate after the first frame
+        std::vector<u8> runAheadState;
+        std::array<u8, 160 * 144> runAheadFramebuffer;
+        RunAheadStats runAheadStats;
 
-        GameBoy();
+        // Save states start with this header and are only loaded into the same ROM they came from
+        static constexpr u32 stateMagic = 0x53534247; // "GBSS"
+        static constexpr u16 stateVersion = 2;
 
-        void reboot();
+        struct StateHeader
+        {
+            u32 magic;
+            u16 version;
+            u8 cartType;
+            u8 ramBanks;
+            u16 romBanks;
+            u16 globalChecksum;
+            u32 size;
+
+            bool operator==(const StateHeader&) const = default;
+        };
+
+        StateHeader getStateHeader() const;
+        void writeState(StateWriter& state) const;
+
+        // One frame of emulation without recording rewind history
+        void runFrame();
+
+        // Check the header and open the image, reporting why and returning nullptr if the ROM
+        // can't run. Changes nothing, so a failed load or reboot keeps the current ROM.
+        std::shared_ptr<const ROMImage> openROM(const std::string& path);
+
+        // Put an image from openROM into the cart
+        void insertROM(const std::string& path, std::shared_ptr<const ROMImage> image);
+
+    public:
+        GameBoy(const Options& options = Options());
 
-        std::array<u8, 160 * 144 * 3>& getFramebuffer();
+        // Reload the ROM from its file and start over, returns false and changes nothing if it doesn't load anymore
+        bool reboot();
+
+        // Convert the last frame to the given format, the span stays valid until the next call
+        std::span<const u8> getFramebuffer(PPU::PixelFormat format);
 
         std::string getTitle();
 
+        const ErrorCollector& getErrors() const;
+
+        CPU::IdleLoopStats getIdleLoopStats();
+
+        #ifdef CPU_JIT
+            CPU::JITStats getJITStats();
+        #endif
+
         void pressButton(Joypad::Button button);
         void releaseButton(Joypad::Button button);
 
+        // Bytes saveState needs for the loaded ROM
+        size_t getStateSize() const;
+
+        // Snapshot the machine into buffer without allocating, returns the bytes written or 0 if it doesn't fit
+        size_t saveState(std::span<u8> buffer) const;
+
+        // Restore a snapshot from saveState, returns false and leaves the machine untouched if it
+        // has another version or came from another ROM
+        bool loadState(std::span<const u8> state);
+
+        // Keep a snapshot every interval frames in a ring of capacity bytes, an interval of 0 turns rewinding off
+        void setRewind(const u16 interval, const size_t capacity);
+
+        // Step back one snapshot, returns false once the history is used up or rewinding is off
+        bool rewind();
+
+        Rewind::Stats getRewindStats();
+
         void loadBootROM(std::string path);
-        void loadROM(std::string path);
+
+        // Returns false and keeps the previous ROM if the file can't be opened or its header is invalid
+        bool loadROM(std::string path);
 
         void step();
+
+        // Run one frame, then frames more without rendering all but the last, show that one and roll
+        // back to the end of the first. Input given before the call shows up frames earlier than with
+        // step, as long as the game only reacts to it that many frames late anyway.
+        void runAhead(const u8 frames);
+
+        RunAheadStats getRunAheadStats();
         
         // void createGameBoyDoctorLog();
         // void initNcurses();
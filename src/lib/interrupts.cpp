@@ -3,7 +3,7 @@
 #include "cpu.h"
 #include "gameboy.h"
 
-Interrupts::Interrupts()
+Interrupts::Interrupts(const Options& options) : options(options)
 {
     this->restart();
 }
@@ -13,12 +13,26 @@ void Interrupts::restart()
     this->ime = true;
     this->enable = 0;
 
-    if(GameBoy::skipBootROM)
+    if(this->options.skipBootROM)
         this->flag = 0xE1;
     else
         this->flag = 0;
 }
 
+void Interrupts::saveState(StateWriter& state) const
+{
+    state.write(this->ime);
+    state.write(this->flag);
+    state.write(this->enable);
+}
+
+void Interrupts::loadState(StateReader& state)
+{
+    state.read(this->ime);
+    state.read(this->flag);
+    state.read(this->enable);
+}
+
 bool Interrupts::getFlag(Interrupt interrupt)
 {
     return this->flag & static_cast<u8>(interrupt);
@@ -39,6 +53,7 @@ void Interrupts::fire(Interrupt interrupt, CPU& cpu)
     this->ime = false;
     cpu.PUSH(cpu.pc);
     cpu.halted = false;
+    cpu.forgetIdleLoop();
 
     switch(interrupt)
     {
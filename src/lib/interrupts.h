@@ -1,6 +1,8 @@
 #pragma once
 
 #include "types.h"
+#include "state.h"
+#include "options.h"
 
 class CPU;
 
@@ -21,6 +23,8 @@ class Interrupts
         u8 flag;
         u8 enable;
 
+        const Options& options;
+
         friend class Bus;
         friend class GameBoy;
         friend class CPU;
@@ -28,10 +32,13 @@ class Interrupts
         void fire(Interrupt interrupt, CPU& cpu);
 
     public:
-        Interrupts();
+        Interrupts(const Options& options);
 
         void restart();
 
+        void saveState(StateWriter& state) const;
+        void loadState(StateReader& state);
+
         bool getFlag(Interrupt interrupt);
         void setFlag(Interrupt interrupt, bool val);
 
@@ -0,0 +1,250 @@
+#include "jit.h"
+
+#ifdef CPU_JIT
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include "opcodes.h"
+
+JIT::JIT() : used(0), cursor(nullptr)
+{
+    void* memory = mmap(nullptr, JIT::arenaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    this->arena = memory == MAP_FAILED ? nullptr : static_cast<u8*>(memory);
+}
+
+JIT::~JIT()
+{
+    if(this->arena)
+        munmap(this->arena, JIT::arenaSize);
+}
+
+void JIT::reset()
+{
+    this->used = 0;
+}
+
+// =================================================================================
+// Emitter
+// =================================================================================
+
+void JIT::emit(const u8 byte)
+{
+    *this->cursor++ = byte;
+}
+
+void JIT::emit16(const u16 val)
+{
+    memcpy(this->cursor, &val, sizeof(val));
+    this->cursor += sizeof(val);
+}
+
+void JIT::emit32(const u32 val)
+{
+    memcpy(this->cursor, &val, sizeof(val));
+    this->cursor += sizeof(val);
+}
+
+void JIT::emit64(const u64 val)
+{
+    memcpy(this->cursor, &val, sizeof(val));
+    this->cursor += sizeof(val);
+}
+
+void JIT::emitCall(const void* function)
+{
+    // mov rax, imm64; call rax
+    this->emit(0x48); this->emit(0xB8); this->emit64(reinterpret_cast<u64>(function));
+    this->emit(0xFF); this->emit(0xD0);
+}
+
+bool JIT::accessesMemory(const u8 opcode, const u16 operand)
+{
+    const char* mnemonic = opcode == 0xCB ? Opcodes::extended[operand & 0xFF].mnemonic : Opcodes::base[opcode].mnemonic;
+
+    return strchr(mnemonic, '(') || strncmp(mnemonic, "PUSH", 4) == 0 || strncmp(mnemonic, "POP", 3) == 0;
+}
+
+// =================================================================================
+// Translation
+// =================================================================================
+
+bool JIT::emitNative(const CPU::DecodedInstruction& instruction, const Layout& layout)
+{
+    const u8 opcode = instruction.opcode;
+
+    // NOP
+    if(opcode == 0x00)
+        return true;
+
+    // LD r,r'
+    if(opcode >= 0x40 && opcode <= 0x7F)
+    {
+        const u8 dest = (opcode >> 3) & 0x07;
+        const u8 src = opcode & 0x07;
+
+        if(dest == 6 || src == 6)
+            return false;
+
+        this->emit(0x0F); this->emit(0xB6); this->emit(0x83); this->emit32(layout.registers[src]);  // movzx eax, byte [rbx + src]
+        this->emit(0x88); this->emit(0x83); this->emit32(layout.registers[dest]);                   // mov [rbx + dest], al
+        return true;
+    }
+
+    // LD r,d8
+    if((opcode & 0xC7) == 0x06 && opcode != 0x36)
+    {
+        this->emit(0xC6); this->emit(0x83); this->emit32(layout.registers[opcode >> 3]); this->emit(instruction.operand & 0xFF);
+        return true;
+    }
+
+    // LD rr,d16
+    if((opcode & 0xCF) == 0x01)
+    {
+        this->emit(0x66); this->emit(0xC7); this->emit(0x83); this->emit32(layout.pairs[opcode >> 4]); this->emit16(instruction.operand);
+        return true;
+    }
+
+    // INC rr, DEC rr
+    if((opcode & 0xC7) == 0x03)
+    {
+        const u8 modrm = opcode & 0x08 ? 0xAB : 0x83; // sub or add word [rbx + disp32], imm8
+        this->emit(0x66); this->emit(0x83); this->emit(modrm); this->emit32(layout.pairs[opcode >> 4]); this->emit(0x01);
+        return true;
+    }
+
+    // LD SP,HL
+    if(opcode == 0xF9)
+    {
+        this->emit(0x0F); this->emit(0xB7); this->emit(0x83); this->emit32(layout.pairs[2]);        // movzx eax, word [rbx + hl]
+        this->emit(0x66); this->emit(0x89); this->emit(0x83); this->emit32(layout.pairs[3]);        // mov [rbx + sp], ax
+        return true;
+    }
+
+    return false;
+}
+
+CPU::CompiledBlock JIT::compile(const CPU& cpu, const CPU::Block& block)
+{
+    const size_t size = 32 + block.count * JIT::maxInstructionSize;
+
+    if(!this->arena || this->used + size > JIT::arenaSize)
+        return nullptr;
+
+    if(mprotect(this->arena, JIT::arenaSize, PROT_READ | PROT_WRITE) != 0)
+        return nullptr;
+
+    u8* const start = this->arena + this->used;
+    this->cursor = start;
+
+    const u8* base = reinterpret_cast<const u8*>(&cpu);
+    const auto offset = [base](const void* field) { return static_cast<u32>(static_cast<const u8*>(field) - base); };
+
+    const Layout layout =
+    {
+        {offset(&cpu.bc.hi), offset(&cpu.bc.lo), offset(&cpu.de.hi), offset(&cpu.de.lo), offset(&cpu.hl.hi), offset(&cpu.hl.lo), 0, offset(&cpu.af.hi)},
+        {offset(&cpu.bc.pair), offset(&cpu.de.pair), offset(&cpu.hl.pair), offset(&cpu.sp)},
+        offset(&cpu.pc),
+        offset(&cpu.operand),
+    };
+
+    // rbx holds the CPU and r12 the cycle counter across handler calls, the extra 8 bytes keep
+    // the stack 16-byte aligned at every call
+    this->emit(0x53);                                               // push rbx
+    this->emit(0x41); this->emit(0x54);                             // push r12
+    this->emit(0x48); this->emit(0x83); this->emit(0xEC); this->emit(0x08); // sub rsp, 8
+    this->emit(0x48); this->emit(0x89); this->emit(0xFB);           // mov rbx, rdi
+    this->emit(0x49); this->emit(0x89); this->emit(0xF4);           // mov r12, rsi
+
+    u8* exits[CPU::maxBlockInstructions];
+    u8 exitCount = 0;
+
+    u32 remaining = block.maxCycles;
+
+    // PC and cycle updates of inline instructions are batched until the next handler call
+    u16 pendingPC = 0;
+    u32 pendingCycles = 0;
+
+    const auto flush = [&]()
+    {
+        if(pendingPC)
+        {
+            // add word [rbx + pc], imm16
+            this->emit(0x66); this->emit(0x81); this->emit(0x83); this->emit32(layout.pc); this->emit16(pendingPC);
+            pendingPC = 0;
+        }
+
+        if(pendingCycles)
+        {
+            // add qword [r12], imm32
+            this->emit(0x49); this->emit(0x81); this->emit(0x04); this->emit(0x24); this->emit32(pendingCycles);
+            pendingCycles = 0;
+        }
+    };
+
+    for(u8 i = 0; i < block.count; ++i)
+    {
+        const CPU::DecodedInstruction& instruction = block.instructions[i];
+        const bool extended = instruction.opcode == 0xCB;
+
+        remaining -= Opcodes::getMaxCycles(instruction.opcode, instruction.operand & 0xFF);
+        pendingPC += instruction.length;
+
+        if(this->emitNative(instruction, layout))
+        {
+            pendingCycles += Opcodes::base[instruction.opcode].cycles;
+            continue;
+        }
+
+        flush();
+
+        // The extended handler is called directly, so the 0xCB prefix needs no operand
+        if(instruction.length > 1 && !extended)
+        {
+            // mov word [rbx + operand], imm16
+            this->emit(0x66); this->emit(0xC7); this->emit(0x83); this->emit32(layout.operand); this->emit16(instruction.operand);
+        }
+
+        const CPU::ThreadedHandler handler = extended ? CPU::getThreadedHandler(instruction.operand & 0xFF, true) : CPU::getThreadedHandler(instruction.opcode, false);
+
+        this->emit(0x48); this->emit(0x89); this->emit(0xDF);           // mov rdi, rbx
+        this->emitCall(reinterpret_cast<const void*>(handler));
+        this->emit(0x0F); this->emit(0xB6); this->emit(0xC0);           // movzx eax, al
+        this->emit(0x49); this->emit(0x01); this->emit(0x04); this->emit(0x24); // add [r12], rax
+
+        if(i + 1 < block.count && JIT::accessesMemory(instruction.opcode, instruction.operand))
+        {
+            this->emit(0x48); this->emit(0x89); this->emit(0xDF);       // mov rdi, rbx
+            this->emit(0xBE); this->emit32(remaining);                  // mov esi, remaining
+            this->emit(0x48); this->emit(0xBA); this->emit64(reinterpret_cast<u64>(block.page)); // mov rdx, page
+            this->emitCall(reinterpret_cast<const void*>(&CPU::shouldExitCompiledBlock));
+            this->emit(0x84); this->emit(0xC0);                         // test al, al
+            this->emit(0x0F); this->emit(0x85);                         // jnz exit
+            exits[exitCount++] = this->cursor;
+            this->emit32(0);
+        }
+    }
+
+    flush();
+
+    const u8* exit = this->cursor;
+    for(u8 i = 0; i < exitCount; ++i)
+    {
+        const i32 displacement = static_cast<i32>(exit - (exits[i] + 4));
+        memcpy(exits[i], &displacement, sizeof(displacement));
+    }
+
+    this->emit(0x48); this->emit(0x83); this->emit(0xC4); this->emit(0x08); // add rsp, 8
+    this->emit(0x41); this->emit(0x5C);                             // pop r12
+    this->emit(0x5B);                                               // pop rbx
+    this->emit(0xC3);                                               // ret
+
+    this->used = (this->cursor - this->arena + 15) & ~static_cast<size_t>(15);
+
+    if(mprotect(this->arena, JIT::arenaSize, PROT_READ | PROT_EXEC) != 0)
+        return nullptr;
+
+    return reinterpret_cast<CPU::CompiledBlock>(start);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include "types.h"
+#include "cpu.h"
+
+// Translates hot ROM blocks to x86-64. Every SM83 instruction becomes a direct call to its
+// opcode handler with the PC, operand and cycle bookkeeping emitted inline, so no decode or
+// dispatch is left at run time. Instructions that touch memory are followed by an exit check
+// for interrupts, bank switches and events scheduled by the access.
+class JIT
+{
+    private:
+        static constexpr size_t arenaSize = 4 * 1024 * 1024;
+
+        // Worst case for a single instruction plus its exit check
+        static constexpr size_t maxInstructionSize = 96;
+
+        u8* arena;
+        size_t used;
+        u8* cursor;
+
+        void emit(const u8 byte);
+        void emit16(const u16 val);
+        void emit32(const u32 val);
+        void emit64(const u64 val);
+
+        void emitCall(const void* function);
+
+        // Field offsets into CPU, the emitted code addresses registers relative to it
+        struct Layout
+        {
+            u32 registers[8];   // B, C, D, E, H, L, unused for (HL), A
+            u32 pairs[4];       // BC, DE, HL, SP
+            u32 pc;
+            u32 operand;
+        };
+
+        static bool accessesMemory(const u8 opcode, const u16 operand);
+
+        // Register moves and 16-bit loads/increments don't touch flags or memory and are emitted
+        // inline, returns false for anything that needs its handler
+        bool emitNative(const CPU::DecodedInstruction& instruction, const Layout& layout);
+
+    public:
+        JIT();
+        ~JIT();
+
+        JIT(const JIT&) = delete;
+        JIT& operator=(const JIT&) = delete;
+
+        // Forget all compiled code
+        void reset();
+
+        // Translate one decoded block, returns nullptr once the arena is full
+        CPU::CompiledBlock compile(const CPU& cpu, const CPU::Block& block);
+};
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 #include "gameboy.h"
 
-Joypad::Joypad(Bus& bus, Interrupts& interrupts) : bus(bus), interrupts(interrupts)
+Joypad::Joypad(Bus& bus, Interrupts& interrupts, const Options& options) : bus(bus), interrupts(interrupts), options(options)
 {
     this->restart();
 }
@@ -12,12 +12,26 @@ void Joypad::restart()
     this->actionButtonState = 0xFF;
     this->directionalButtonState = 0xFF;
 
-    if(GameBoy::skipBootROM)
+    if(this->options.skipBootROM)
         this->joyp = 0xCF;
     else
         this->joyp = 0;
 }
 
+void Joypad::saveState(StateWriter& state) const
+{
+    state.write(this->joyp);
+    state.write(this->actionButtonState);
+    state.write(this->directionalButtonState);
+}
+
+void Joypad::loadState(StateReader& state)
+{
+    state.read(this->joyp);
+    state.read(this->actionButtonState);
+    state.read(this->directionalButtonState);
+}
+
 bool Joypad::areActionButtonsSelected()
 {
     return !(this->joyp & 0x20);
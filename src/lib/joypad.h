@@ -1,6 +1,8 @@
 #pragma once
 
 #include "types.h"
+#include "state.h"
+#include "options.h"
 #include "bus.h"
 #include "interrupts.h"
 
@@ -16,6 +18,7 @@ class Joypad
 
         Interrupts& interrupts;
         Bus& bus;
+        const Options& options;
         friend class Bus;
         friend class GameBoy;
 
@@ -32,10 +35,13 @@ class Joypad
             Right,
         };
 
-        Joypad(Bus& bus, Interrupts& interrupts);
+        Joypad(Bus& bus, Interrupts& interrupts, const Options& options);
 
         void restart();
 
+        void saveState(StateWriter& state) const;
+        void loadState(StateReader& state);
+
         void pressButton(Button button);
         void releaseButton(Button button);
 
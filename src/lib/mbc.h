@@ -1,25 +1,73 @@
 #pragma once
 
+#include <variant>
 #include "types.h"
+#include "state.h"
 
-class Cart;
+// ROM and RAM of the cart, owned by Cart and handed to the mapper when the ROM is loaded
+struct CartMemory
+{
+    const u8* rom = nullptr;
+    u8* ram = nullptr;
+    u16 romBanks = 0;
+    u8 ramBanks = 0;
+};
+
+// Mappers share no base class. Each has the same members and is stored by value in the MBC
+// variant below, so Cart dispatches with std::visit and the accesses inline into the bus slow
+// path instead of going through a vtable.
 
-class MBC
+class ROMOnly
 {
+    private:
+        CartMemory memory;
+
     public:
-        Cart& cart;
+        ROMOnly(const CartMemory& memory = CartMemory()) : memory(memory)
+        {
+
+        }
+
+        u8 readByte(const u16 addr) const
+        {
+            return addr <= 0x7FFF ? this->memory.rom[addr] : 0xFF;
+        }
+
+        void writeByte(const u16, const u8)
+        {
+
+        }
+
+        // Host pointer to the byte currently mapped at addr, or nullptr if accesses must go through readByte/writeByte
+        const u8* mapROM(const u16 addr) const
+        {
+            return &this->memory.rom[addr];
+        }
 
-        MBC(Cart& cart);
-        virtual ~MBC() = default;
+        u8* mapRAM(const u16) const
+        {
+            return nullptr;
+        }
 
-        virtual u8 readByte(const u16 addr) const = 0;
-        virtual void writeByte(const u16 addr, const u8 val) = 0;
+        // Bank registers for save states
+        void saveState(StateWriter&) const {}
+        void loadState(StateReader&) {}
 };
 
-class MBC1 : public MBC
+class MBC1
 {
     private:
-        using MBC::MBC;
+        CartMemory memory;
+
+        u8 getROMBank() const
+        {
+            return ((this->ramBankNumber << 5) | this->romBankNumber) % this->memory.romBanks;
+        }
+
+        u8 getRAMBank() const
+        {
+            return this->bankingModeSelect * this->ramBankNumber % this->memory.ramBanks;
+        }
 
     public:
         bool ramEnable = false;
@@ -27,17 +75,107 @@ class MBC1 : public MBC
         u8 ramBankNumber = 0;
         bool bankingModeSelect = 0;
 
-    public:
-        u8 readByte(const u16 addr) const;
-        void writeByte(const u16 addr, const u8 val);
+        MBC1(const CartMemory& memory) : memory(memory)
+        {
+
+        }
+
+        u8 readByte(const u16 addr) const
+        {
+            // ROM Bank 0
+            if(addr <= 0x3FFF)
+                return this->memory.rom[addr];
+
+            // ROM Bank 01-7F
+            if(addr <= 0x7FFF)
+                return this->memory.rom[(0x4000 * this->getROMBank()) + (addr - 0x4000)];
+
+            // RAM Bank 0-3
+            if(addr >= 0xA000 && addr <= 0xBFFF)
+            {
+                if(!this->ramEnable || !this->memory.ramBanks)
+                    return 0xFF;
+
+                return this->memory.ram[(addr - 0xA000) + (0x2000 * this->getRAMBank())];
+            }
+
+            return 0xFF;
+        }
+
+        void writeByte(const u16 addr, const u8 val)
+        {
+            switch(addr >> 13)
+            {
+                // Enable RAM
+                case 0x0000 >> 13:
+                    this->ramEnable = (val & 0xF) == 0xA;
+                    break;
+
+                // ROM Bank
+                case 0x2000 >> 13:
+                    this->romBankNumber = val ? val & 0x1F : 1;
+                    break;
+
+                // RAM Bank
+                case 0x4000 >> 13:
+                    this->ramBankNumber = val & 2;
+                    break;
+
+                // Mode Select
+                case 0x6000 >> 13:
+                    this->bankingModeSelect = val == 1;
+                    break;
+
+                // External RAM
+                case 0xA000 >> 13:
+                    if(this->ramEnable && this->memory.ramBanks)
+                        this->memory.ram[(addr - 0xA000) + (0x2000 * this->getRAMBank())] = val;
+                    break;
+            }
+        }
+
+        const u8* mapROM(const u16 addr) const
+        {
+            // ROM Bank 0
+            if(addr <= 0x3FFF)
+                return &this->memory.rom[addr];
+
+            // ROM Bank 01-7F
+            return &this->memory.rom[(0x4000 * this->getROMBank()) + (addr - 0x4000)];
+        }
+
+        u8* mapRAM(const u16 addr) const
+        {
+            if(!this->ramEnable || !this->memory.ramBanks)
+                return nullptr;
+
+            return &this->memory.ram[(addr - 0xA000) + (0x2000 * this->getRAMBank())];
+        }
+
+        void saveState(StateWriter& state) const;
+        void loadState(StateReader& state);
 };
 
-class MBC3 : public MBC
+class MBC3
 {
     private:
-        using MBC::MBC;
+        CartMemory memory;
 
     public:
+        MBC3(const CartMemory& memory) : memory(memory)
+        {
+
+        }
+
         u8 readByte(const u16 addr) const;
         void writeByte(const u16 addr, const u8 val);
-};
\ No newline at end of file
+
+        const u8* mapROM(const u16) const { return nullptr; }
+        u8* mapRAM(const u16) const { return nullptr; }
+
+        void saveState(StateWriter&) const {}
+        void loadState(StateReader&) {}
+};
+
+// The mapper of the loaded cart, ROMOnly until a ROM is loaded
+using MBC = std::variant<ROMOnly, MBC1, MBC3>;
\ No newline at end of file
@@ -0,0 +1,566 @@
+#pragma once
+
+#include <array>
+#include "types.h"
+
+// Static description of an SM83 opcode
+// Cycle counts are in T-cycles. branchCycles is the cost of a conditional JR/JP/CALL/RET
+// when its condition holds; for every other opcode it equals cycles.
+struct OpcodeInfo
+{
+    const char* mnemonic;
+    u8 length; // Including the opcode (and the 0xCB prefix for extended opcodes)
+    u8 cycles;
+    u8 branchCycles;
+};
+
+// Expands X(opcode) for all 256 opcodes, used to generate labels and handler tables
+#define OPCODE_LIST(X) \
+    X(0x00) X(0x01) X(0x02) X(0x03) X(0x04) X(0x05) X(0x06) X(0x07) X(0x08) X(0x09) X(0x0A) X(0x0B) X(0x0C) X(0x0D) X(0x0E) X(0x0F) \
+    X(0x10) X(0x11) X(0x12) X(0x13) X(0x14) X(0x15) X(0x16) X(0x17) X(0x18) X(0x19) X(0x1A) X(0x1B) X(0x1C) X(0x1D) X(0x1E) X(0x1F) \
+    X(0x20) X(0x21) X(0x22) X(0x23) X(0x24) X(0x25) X(0x26) X(0x27) X(0x28) X(0x29) X(0x2A) X(0x2B) X(0x2C) X(0x2D) X(0x2E) X(0x2F) \
+    X(0x30) X(0x31) X(0x32) X(0x33) X(0x34) X(0x35) X(0x36) X(0x37) X(0x38) X(0x39) X(0x3A) X(0x3B) X(0x3C) X(0x3D) X(0x3E) X(0x3F) \
+    X(0x40) X(0x41) X(0x42) X(0x43) X(0x44) X(0x45) X(0x46) X(0x47) X(0x48) X(0x49) X(0x4A) X(0x4B) X(0x4C) X(0x4D) X(0x4E) X(0x4F) \
+    X(0x50) X(0x51) X(0x52) X(0x53) X(0x54) X(0x55) X(0x56) X(0x57) X(0x58) X(0x59) X(0x5A) X(0x5B) X(0x5C) X(0x5D) X(0x5E) X(0x5F) \
+    X(0x60) X(0x61) X(0x62) X(0x63) X(0x64) X(0x65) X(0x66) X(0x67) X(0x68) X(0x69) X(0x6A) X(0x6B) X(0x6C) X(0x6D) X(0x6E) X(0x6F) \
+    X(0x70) X(0x71) X(0x72) X(0x73) X(0x74) X(0x75) X(0x76) X(0x77) X(0x78) X(0x79) X(0x7A) X(0x7B) X(0x7C) X(0x7D) X(0x7E) X(0x7F) \
+    X(0x80) X(0x81) X(0x82) X(0x83) X(0x84) X(0x85) X(0x86) X(0x87) X(0x88) X(0x89) X(0x8A) X(0x8B) X(0x8C) X(0x8D) X(0x8E) X(0x8F) \
+    X(0x90) X(0x91) X(0x92) X(0x93) X(0x94) X(0x95) X(0x96) X(0x97) X(0x98) X(0x99) X(0x9A) X(0x9B) X(0x9C) X(0x9D) X(0x9E) X(0x9F) \
+    X(0xA0) X(0xA1) X(0xA2) X(0xA3) X(0xA4) X(0xA5) X(0xA6) X(0xA7) X(0xA8) X(0xA9) X(0xAA) X(0xAB) X(0xAC) X(0xAD) X(0xAE) X(0xAF) \
+    X(0xB0) X(0xB1) X(0xB2) X(0xB3) X(0xB4) X(0xB5) X(0xB6) X(0xB7) X(0xB8) X(0xB9) X(0xBA) X(0xBB) X(0xBC) X(0xBD) X(0xBE) X(0xBF) \
+    X(0xC0) X(0xC1) X(0xC2) X(0xC3) X(0xC4) X(0xC5) X(0xC6) X(0xC7) X(0xC8) X(0xC9) X(0xCA) X(0xCB) X(0xCC) X(0xCD) X(0xCE) X(0xCF) \
+    X(0xD0) X(0xD1) X(0xD2) X(0xD3) X(0xD4) X(0xD5) X(0xD6) X(0xD7) X(0xD8) X(0xD9) X(0xDA) X(0xDB) X(0xDC) X(0xDD) X(0xDE) X(0xDF) \
+    X(0xE0) X(0xE1) X(0xE2) X(0xE3) X(0xE4) X(0xE5) X(0xE6) X(0xE7) X(0xE8) X(0xE9) X(0xEA) X(0xEB) X(0xEC) X(0xED) X(0xEE) X(0xEF) \
+    X(0xF0) X(0xF1) X(0xF2) X(0xF3) X(0xF4) X(0xF5) X(0xF6) X(0xF7) X(0xF8) X(0xF9) X(0xFA) X(0xFB) X(0xFC) X(0xFD) X(0xFE) X(0xFF)
+
+namespace Opcodes
+{
+    constexpr std::array<OpcodeInfo, 256> base =
+    {{
+        {"NOP", 1, 4, 4},             // 0x00
+        {"LD BC,d16", 3, 12, 12},     // 0x01
+        {"LD (BC),A", 1, 8, 8},       // 0x02
+        {"INC BC", 1, 8, 8},          // 0x03
+        {"INC B", 1, 4, 4},           // 0x04
+        {"DEC B", 1, 4, 4},           // 0x05
+        {"LD B,d8", 2, 8, 8},         // 0x06
+        {"RLCA", 1, 4, 4},            // 0x07
+        {"LD (a16),SP", 3, 20, 20},   // 0x08
+        {"ADD HL,BC", 1, 8, 8},       // 0x09
+        {"LD A,(BC)", 1, 8, 8},       // 0x0A
+        {"DEC BC", 1, 8, 8},          // 0x0B
+        {"INC C", 1, 4, 4},           // 0x0C
+        {"DEC C", 1, 4, 4},           // 0x0D
+        {"LD C,d8", 2, 8, 8},         // 0x0E
+        {"RRCA", 1, 4, 4},            // 0x0F
+        {"STOP", 2, 4, 4},            // 0x10
+        {"LD DE,d16", 3, 12, 12},     // 0x11
+        {"LD (DE),A", 1, 8, 8},       // 0x12
+        {"INC DE", 1, 8, 8},          // 0x13
+        {"INC D", 1, 4, 4},           // 0x14
+        {"DEC D", 1, 4, 4},           // 0x15
+        {"LD D,d8", 2, 8, 8},         // 0x16
+        {"RLA", 1, 4, 4},             // 0x17
+        {"JR r8", 2, 12, 12},         // 0x18
+        {"ADD HL,DE", 1, 8, 8},       // 0x19
+        {"LD A,(DE)", 1, 8, 8},       // 0x1A
+        {"DEC DE", 1, 8, 8},          // 0x1B
+        {"INC E", 1, 4, 4},           // 0x1C
+        {"DEC E", 1, 4, 4},           // 0x1D
+        {"LD E,d8", 2, 8, 8},         // 0x1E
+        {"RRA", 1, 4, 4},             // 0x1F
+        {"JR NZ,r8", 2, 8, 12},       // 0x20
+        {"LD HL,d16", 3, 12, 12},     // 0x21
+        {"LD (HL+),A", 1, 8, 8},      // 0x22
+        {"INC HL", 1, 8, 8},          // 0x23
+        {"INC H", 1, 4, 4},           // 0x24
+        {"DEC H", 1, 4, 4},           // 0x25
+        {"LD H,d8", 2, 8, 8},         // 0x26
+        {"DAA", 1, 4, 4},             // 0x27
+        {"JR Z,r8", 2, 8, 12},        // 0x28
+        {"ADD HL,HL", 1, 8, 8},       // 0x29
+        {"LD A,(HL+)", 1, 8, 8},      // 0x2A
+        {"DEC HL", 1, 8, 8},          // 0x2B
+        {"INC L", 1, 4, 4},           // 0x2C
+        {"DEC L", 1, 4, 4},           // 0x2D
+        {"LD L,d8", 2, 8, 8},         // 0x2E
+        {"CPL", 1, 4, 4},             // 0x2F
+        {"JR NC,r8", 2, 8, 12},       // 0x30
+        {"LD SP,d16", 3, 12, 12},     // 0x31
+        {"LD (HL-),A", 1, 8, 8},      // 0x32
+        {"INC SP", 1, 8, 8},          // 0x33
+        {"INC (HL)", 1, 12, 12},      // 0x34
+        {"DEC (HL)", 1, 12, 12},      // 0x35
+        {"LD (HL),d8", 2, 12, 12},    // 0x36
+        {"SCF", 1, 4, 4},             // 0x37
+        {"JR C,r8", 2, 8, 12},        // 0x38
+        {"ADD HL,SP", 1, 8, 8},       // 0x39
+        {"LD A,(HL-)", 1, 8, 8},      // 0x3A
+        {"DEC SP", 1, 8, 8},          // 0x3B
+        {"INC A", 1, 4, 4},           // 0x3C
+        {"DEC A", 1, 4, 4},           // 0x3D
+        {"LD A,d8", 2, 8, 8},         // 0x3E
+        {"CCF", 1, 4, 4},             // 0x3F
+        {"LD B,B", 1, 4, 4},          // 0x40
+        {"LD B,C", 1, 4, 4},          // 0x41
+        {"LD B,D", 1, 4, 4},          // 0x42
+        {"LD B,E", 1, 4, 4},          // 0x43
+        {"LD B,H", 1, 4, 4},          // 0x44
+        {"LD B,L", 1, 4, 4},          // 0x45
+        {"LD B,(HL)", 1, 8, 8},       // 0x46
+        {"LD B,A", 1, 4, 4},          // 0x47
+        {"LD C,B", 1, 4, 4},          // 0x48
+        {"LD C,C", 1, 4, 4},          // 0x49
+        {"LD C,D", 1, 4, 4},          // 0x4A
+        {"LD C,E", 1, 4, 4},          // 0x4B
+        {"LD C,H", 1, 4, 4},          // 0x4C
+        {"LD C,L", 1, 4, 4},          // 0x4D
+        {"LD C,(HL)", 1, 8, 8},       // 0x4E
+        {"LD C,A", 1, 4, 4},          // 0x4F
+        {"LD D,B", 1, 4, 4},          // 0x50
+        {"LD D,C", 1, 4, 4},          // 0x51
+        {"LD D,D", 1, 4, 4},          // 0x52
+        {"LD D,E", 1, 4, 4},          // 0x53
+        {"LD D,H", 1, 4, 4},          // 0x54
+        {"LD D,L", 1, 4, 4},          // 0x55
+        {"LD D,(HL)", 1, 8, 8},       // 0x56
+        {"LD D,A", 1, 4, 4},          // 0x57
+        {"LD E,B", 1, 4, 4},          // 0x58
+        {"LD E,C", 1, 4, 4},          // 0x59
+        {"LD E,D", 1, 4, 4},          // 0x5A
+        {"LD E,E", 1, 4, 4},          // 0x5B
+        {"LD E,H", 1, 4, 4},          // 0x5C
+        {"LD E,L", 1, 4, 4},          // 0x5D
+        {"LD E,(HL)", 1, 8, 8},       // 0x5E
+        {"LD E,A", 1, 4, 4},          // 0x5F
+        {"LD H,B", 1, 4, 4},          // 0x60
+        {"LD H,C", 1, 4, 4},          // 0x61
+        {"LD H,D", 1, 4, 4},          // 0x62
+        {"LD H,E", 1, 4, 4},          // 0x63
+        {"LD H,H", 1, 4, 4},          // 0x64
+        {"LD H,L", 1, 4, 4},          // 0x65
+        {"LD H,(HL)", 1, 8, 8},       // 0x66
+        {"LD H,A", 1, 4, 4},          // 0x67
+        {"LD L,B", 1, 4, 4},          // 0x68
+        {"LD L,C", 1, 4, 4},          // 0x69
+        {"LD L,D", 1, 4, 4},          // 0x6A
+        {"LD L,E", 1, 4, 4},          // 0x6B
+        {"LD L,H", 1, 4, 4},          // 0x6C
+        {"LD L,L", 1, 4, 4},          // 0x6D
+        {"LD L,(HL)", 1, 8, 8},       // 0x6E
+        {"LD L,A", 1, 4, 4},          // 0x6F
+        {"LD (HL),B", 1, 8, 8},       // 0x70
+        {"LD (HL),C", 1, 8, 8},       // 0x71
+        {"LD (HL),D", 1, 8, 8},       // 0x72
+        {"LD (HL),E", 1, 8, 8},       // 0x73
+        {"LD (HL),H", 1, 8, 8},       // 0x74
+        {"LD (HL),L", 1, 8, 8},       // 0x75
+        {"HALT", 1, 4, 4},            // 0x76
+        {"LD (HL),A", 1, 8, 8},       // 0x77
+        {"LD A,B", 1, 4, 4},          // 0x78
+        {"LD A,C", 1, 4, 4},          // 0x79
+        {"LD A,D", 1, 4, 4},          // 0x7A
+        {"LD A,E", 1, 4, 4},          // 0x7B
+        {"LD A,H", 1, 4, 4},          // 0x7C
+        {"LD A,L", 1, 4, 4},          // 0x7D
+        {"LD A,(HL)", 1, 8, 8},       // 0x7E
+        {"LD A,A", 1, 4, 4},          // 0x7F
+        {"ADD A,B", 1, 4, 4},         // 0x80
+        {"ADD A,C", 1, 4, 4},         // 0x81
+        {"ADD A,D", 1, 4, 4},         // 0x82
+        {"ADD A,E", 1, 4, 4},         // 0x83
+        {"ADD A,H", 1, 4, 4},         // 0x84
+        {"ADD A,L", 1, 4, 4},         // 0x85
+        {"ADD A,(HL)", 1, 8, 8},      // 0x86
+        {"ADD A,A", 1, 4, 4},         // 0x87
+        {"ADC A,B", 1, 4, 4},         // 0x88
+        {"ADC A,C", 1, 4, 4},         // 0x89
+        {"ADC A,D", 1, 4, 4},         // 0x8A
+        {"ADC A,E", 1, 4, 4},         // 0x8B
+        {"ADC A,H", 1, 4, 4},         // 0x8C
+        {"ADC A,L", 1, 4, 4},         // 0x8D
+        {"ADC A,(HL)", 1, 8, 8},      // 0x8E
+        {"ADC A,A", 1, 4, 4},         // 0x8F
+        {"SUB B", 1, 4, 4},           // 0x90
+        {"SUB C", 1, 4, 4},           // 0x91
+        {"SUB D", 1, 4, 4},           // 0x92
+        {"SUB E", 1, 4, 4},           // 0x93
+        {"SUB H", 1, 4, 4},           // 0x94
+        {"SUB L", 1, 4, 4},           // 0x95
+        {"SUB (HL)", 1, 8, 8},        // 0x96
+        {"SUB A", 1, 4, 4},           // 0x97
+        {"SBC A,B", 1, 4, 4},         // 0x98
+        {"SBC A,C", 1, 4, 4},         // 0x99
+        {"SBC A,D", 1, 4, 4},         // 0x9A
+        {"SBC A,E", 1, 4, 4},         // 0x9B
+        {"SBC A,H", 1, 4, 4},         // 0x9C
+        {"SBC A,L", 1, 4, 4},         // 0x9D
+        {"SBC A,(HL)", 1, 8, 8},      // 0x9E
+        {"SBC A,A", 1, 4, 4},         // 0x9F
+        {"AND B", 1, 4, 4},           // 0xA0
+        {"AND C", 1, 4, 4},           // 0xA1
+        {"AND D", 1, 4, 4},           // 0xA2
+        {"AND E", 1, 4, 4},           // 0xA3
+        {"AND H", 1, 4, 4},           // 0xA4
+        {"AND L", 1, 4, 4},           // 0xA5
+        {"AND (HL)", 1, 8, 8},        // 0xA6
+        {"AND A", 1, 4, 4},           // 0xA7
+        {"XOR B", 1, 4, 4},           // 0xA8
+        {"XOR C", 1, 4, 4},           // 0xA9
+        {"XOR D", 1, 4, 4},           // 0xAA
+        {"XOR E", 1, 4, 4},           // 0xAB
+        {"XOR H", 1, 4, 4},           // 0xAC
+        {"XOR L", 1, 4, 4},           // 0xAD
+        {"XOR (HL)", 1, 8, 8},        // 0xAE
+        {"XOR A", 1, 4, 4},           // 0xAF
+        {"OR B", 1, 4, 4},            // 0xB0
+        {"OR C", 1, 4, 4},            // 0xB1
+        {"OR D", 1, 4, 4},            // 0xB2
+        {"OR E", 1, 4, 4},            // 0xB3
+        {"OR H", 1, 4, 4},            // 0xB4
+        {"OR L", 1, 4, 4},            // 0xB5
+        {"OR (HL)", 1, 8, 8},         // 0xB6
+        {"OR A", 1, 4, 4},            // 0xB7
+        {"CP B", 1, 4, 4},            // 0xB8
+        {"CP C", 1, 4, 4},            // 0xB9
+        {"CP D", 1, 4, 4},            // 0xBA
+        {"CP E", 1, 4, 4},            // 0xBB
+        {"CP H", 1, 4, 4},            // 0xBC
+        {"CP L", 1, 4, 4},            // 0xBD
+        {"CP (HL)", 1, 8, 8},         // 0xBE
+        {"CP A", 1, 4, 4},            // 0xBF
+        {"RET NZ", 1, 8, 20},         // 0xC0
+        {"POP BC", 1, 12, 12},        // 0xC1
+        {"JP NZ,a16", 3, 12, 16},     // 0xC2
+        {"JP a16", 3, 16, 16},        // 0xC3
+        {"CALL NZ,a16", 3, 12, 24},   // 0xC4
+        {"PUSH BC", 1, 16, 16},       // 0xC5
+        {"ADD A,d8", 2, 8, 8},        // 0xC6
+        {"RST 00H", 1, 16, 16},       // 0xC7
+        {"RET Z", 1, 8, 20},          // 0xC8
+        {"RET", 1, 16, 16},           // 0xC9
+        {"JP Z,a16", 3, 12, 16},      // 0xCA
+        {"PREFIX CB", 2, 4, 4},       // 0xCB
+        {"CALL Z,a16", 3, 12, 24},    // 0xCC
+        {"CALL a16", 3, 24, 24},      // 0xCD
+        {"ADC A,d8", 2, 8, 8},        // 0xCE
+        {"RST 08H", 1, 16, 16},       // 0xCF
+        {"RET NC", 1, 8, 20},         // 0xD0
+        {"POP DE", 1, 12, 12},        // 0xD1
+        {"JP NC,a16", 3, 12, 16},     // 0xD2
+        {"ILLEGAL_D3", 1, 4, 4},      // 0xD3
+        {"CALL NC,a16", 3, 12, 24},   // 0xD4
+        {"PUSH DE", 1, 16, 16},       // 0xD5
+        {"SUB d8", 2, 8, 8},          // 0xD6
+        {"RST 10H", 1, 16, 16},       // 0xD7
+        {"RET C", 1, 8, 20},          // 0xD8
+        {"RETI", 1, 16, 16},          // 0xD9
+        {"JP C,a16", 3, 12, 16},      // 0xDA
+        {"ILLEGAL_DB", 1, 4, 4},      // 0xDB
+        {"CALL C,a16", 3, 12, 24},    // 0xDC
+        {"ILLEGAL_DD", 1, 4, 4},      // 0xDD
+        {"SBC A,d8", 2, 8, 8},        // 0xDE
+        {"RST 18H", 1, 16, 16},       // 0xDF
+        {"LDH (a8),A", 2, 12, 12},    // 0xE0
+        {"POP HL", 1, 12, 12},        // 0xE1
+        {"LD (C),A", 1, 8, 8},        // 0xE2
+        {"ILLEGAL_E3", 1, 4, 4},      // 0xE3
+        {"ILLEGAL_E4", 1, 4, 4},      // 0xE4
+        {"PUSH HL", 1, 16, 16},       // 0xE5
+        {"AND d8", 2, 8, 8},          // 0xE6
+        {"RST 20H", 1, 16, 16},       // 0xE7
+        {"ADD SP,r8", 2, 16, 16},     // 0xE8
+        {"JP HL", 1, 4, 4},           // 0xE9
+        {"LD (a16),A", 3, 16, 16},    // 0xEA
+        {"ILLEGAL_EB", 1, 4, 4},      // 0xEB
+        {"ILLEGAL_EC", 1, 4, 4},      // 0xEC
+        {"ILLEGAL_ED", 1, 4, 4},      // 0xED
+        {"XOR d8", 2, 8, 8},          // 0xEE
+        {"RST 28H", 1, 16, 16},       // 0xEF
+        {"LDH A,(a8)", 2, 12, 12},    // 0xF0
+        {"POP AF", 1, 12, 12},        // 0xF1
+        {"LD A,(C)", 1, 8, 8},        // 0xF2
+        {"DI", 1, 4, 4},              // 0xF3
+        {"ILLEGAL_F4", 1, 4, 4},      // 0xF4
+        {"PUSH AF", 1, 16, 16},       // 0xF5
+        {"OR d8", 2, 8, 8},           // 0xF6
+        {"RST 30H", 1, 16, 16},       // 0xF7
+        {"LD HL,SP+r8", 2, 12, 12},   // 0xF8
+        {"LD SP,HL", 1, 8, 8},        // 0xF9
+        {"LD A,(a16)", 3, 16, 16},    // 0xFA
+        {"EI", 1, 4, 4},              // 0xFB
+        {"ILLEGAL_FC", 1, 4, 4},      // 0xFC
+        {"ILLEGAL_FD", 1, 4, 4},      // 0xFD
+        {"CP d8", 2, 8, 8},           // 0xFE
+        {"RST 38H", 1, 16, 16}        // 0xFF
+    }};
+
+    constexpr std::array<OpcodeInfo, 256> extended =
+    {{
+        {"RLC B", 2, 8, 8},           // 0x00
+        {"RLC C", 2, 8, 8},           // 0x01
+        {"RLC D", 2, 8, 8},           // 0x02
+        {"RLC E", 2, 8, 8},           // 0x03
+        {"RLC H", 2, 8, 8},           // 0x04
+        {"RLC L", 2, 8, 8},           // 0x05
+        {"RLC (HL)", 2, 16, 16},      // 0x06
+        {"RLC A", 2, 8, 8},           // 0x07
+        {"RRC B", 2, 8, 8},           // 0x08
+        {"RRC C", 2, 8, 8},           // 0x09
+        {"RRC D", 2, 8, 8},           // 0x0A
+        {"RRC E", 2, 8, 8},           // 0x0B
+        {"RRC H", 2, 8, 8},           // 0x0C
+        {"RRC L", 2, 8, 8},           // 0x0D
+        {"RRC (HL)", 2, 16, 16},      // 0x0E
+        {"RRC A", 2, 8, 8},           // 0x0F
+        {"RL B", 2, 8, 8},            // 0x10
+        {"RL C", 2, 8, 8},            // 0x11
+        {"RL D", 2, 8, 8},            // 0x12
+        {"RL E", 2, 8, 8},            // 0x13
+        {"RL H", 2, 8, 8},            // 0x14
+        {"RL L", 2, 8, 8},            // 0x15
+        {"RL (HL)", 2, 16, 16},       // 0x16
+        {"RL A", 2, 8, 8},            // 0x17
+        {"RR B", 2, 8, 8},            // 0x18
+        {"RR C", 2, 8, 8},            // 0x19
+        {"RR D", 2, 8, 8},            // 0x1A
+        {"RR E", 2, 8, 8},            // 0x1B
+        {"RR H", 2, 8, 8},            // 0x1C
+        {"RR L", 2, 8, 8},            // 0x1D
+        {"RR (HL)", 2, 16, 16},       // 0x1E
+        {"RR A", 2, 8, 8},            // 0x1F
+        {"SLA B", 2, 8, 8},           // 0x20
+        {"SLA C", 2, 8, 8},           // 0x21
+        {"SLA D", 2, 8, 8},           // 0x22
+        {"SLA E", 2, 8, 8},           // 0x23
+        {"SLA H", 2, 8, 8},           // 0x24
+        {"SLA L", 2, 8, 8},           // 0x25
+        {"SLA (HL)", 2, 16, 16},      // 0x26
+        {"SLA A", 2, 8, 8},           // 0x27
+        {"SRA B", 2, 8, 8},           // 0x28
+        {"SRA C", 2, 8, 8},           // 0x29
+        {"SRA D", 2, 8, 8},           // 0x2A
+        {"SRA E", 2, 8, 8},           // 0x2B
+        {"SRA H", 2, 8, 8},           // 0x2C
+        {"SRA L", 2, 8, 8},           // 0x2D
+        {"SRA (HL)", 2, 16, 16},      // 0x2E
+        {"SRA A", 2, 8, 8},           // 0x2F
+        {"SWAP B", 2, 8, 8},          // 0x30
+        {"SWAP C", 2, 8, 8},          // 0x31
+        {"SWAP D", 2, 8, 8},          // 0x32
+        {"SWAP E", 2, 8, 8},          // 0x33
+        {"SWAP H", 2, 8, 8},          // 0x34
+        {"SWAP L", 2, 8, 8},          // 0x35
+        {"SWAP (HL)", 2, 16, 16},     // 0x36
+        {"SWAP A", 2, 8, 8},          // 0x37
+        {"SRL B", 2, 8, 8},           // 0x38
+        {"SRL C", 2, 8, 8},           // 0x39
+        {"SRL D", 2, 8, 8},           // 0x3A
+        {"SRL E", 2, 8, 8},           // 0x3B
+        {"SRL H", 2, 8, 8},           // 0x3C
+        {"SRL L", 2, 8, 8},           // 0x3D
+        {"SRL (HL)", 2, 16, 16},      // 0x3E
+        {"SRL A", 2, 8, 8},           // 0x3F
+        {"BIT 0,B", 2, 8, 8},         // 0x40
+        {"BIT 0,C", 2, 8, 8},         // 0x41
+        {"BIT 0,D", 2, 8, 8},         // 0x42
+        {"BIT 0,E", 2, 8, 8},         // 0x43
+        {"BIT 0,H", 2, 8, 8},         // 0x44
+        {"BIT 0,L", 2, 8, 8},         // 0x45
+        {"BIT 0,(HL)", 2, 12, 12},    // 0x46
+        {"BIT 0,A", 2, 8, 8},         // 0x47
+        {"BIT 1,B", 2, 8, 8},         // 0x48
+        {"BIT 1,C", 2, 8, 8},         // 0x49
+        {"BIT 1,D", 2, 8, 8},         // 0x4A
+        {"BIT 1,E", 2, 8, 8},         // 0x4B
+        {"BIT 1,H", 2, 8, 8},         // 0x4C
+        {"BIT 1,L", 2, 8, 8},         // 0x4D
+        {"BIT 1,(HL)", 2, 12, 12},    // 0x4E
+        {"BIT 1,A", 2, 8, 8},         // 0x4F
+        {"BIT 2,B", 2, 8, 8},         // 0x50
+        {"BIT 2,C", 2, 8, 8},         // 0x51
+        {"BIT 2,D", 2, 8, 8},         // 0x52
+        {"BIT 2,E", 2, 8, 8},         // 0x53
+        {"BIT 2,H", 2, 8, 8},         // 0x54
+        {"BIT 2,L", 2, 8, 8},         // 0x55
+        {"BIT 2,(HL)", 2, 12, 12},    // 0x56
+        {"BIT 2,A", 2, 8, 8},         // 0x57
+        {"BIT 3,B", 2, 8, 8},         // 0x58
+        {"BIT 3,C", 2, 8, 8},         // 0x59
+        {"BIT 3,D", 2, 8, 8},         // 0x5A
+        {"BIT 3,E", 2, 8, 8},         // 0x5B
+        {"BIT 3,H", 2, 8, 8},         // 0x5C
+        {"BIT 3,L", 2, 8, 8},         // 0x5D
+        {"BIT 3,(HL)", 2, 12, 12},    // 0x5E
+        {"BIT 3,A", 2, 8, 8},         // 0x5F
+        {"BIT 4,B", 2, 8, 8},         // 0x60
+        {"BIT 4,C", 2, 8, 8},         // 0x61
+        {"BIT 4,D", 2, 8, 8},         // 0x62
+        {"BIT 4,E", 2, 8, 8},         // 0x63
+        {"BIT 4,H", 2, 8, 8},         // 0x64
+        {"BIT 4,L", 2, 8, 8},         // 0x65
+        {"BIT 4,(HL)", 2, 12, 12},    // 0x66
+        {"BIT 4,A", 2, 8, 8},         // 0x67
+        {"BIT 5,B", 2, 8, 8},         // 0x68
+        {"BIT 5,C", 2, 8, 8},         // 0x69
+        {"BIT 5,D", 2, 8, 8},         // 0x6A
+        {"BIT 5,E", 2, 8, 8},         // 0x6B
+        {"BIT 5,H", 2, 8, 8},         // 0x6C
+        {"BIT 5,L", 2, 8, 8},         // 0x6D
+        {"BIT 5,(HL)", 2, 12, 12},    // 0x6E
+        {"BIT 5,A", 2, 8, 8},         // 0x6F
+        {"BIT 6,B", 2, 8, 8},         // 0x70
+        {"BIT 6,C", 2, 8, 8},         // 0x71
+        {"BIT 6,D", 2, 8, 8},         // 0x72
+        {"BIT 6,E", 2, 8, 8},         // 0x73
+        {"BIT 6,H", 2, 8, 8},         // 0x74
+        {"BIT 6,L", 2, 8, 8},         // 0x75
+        {"BIT 6,(HL)", 2, 12, 12},    // 0x76
+        {"BIT 6,A", 2, 8, 8},         // 0x77
+        {"BIT 7,B", 2, 8, 8},         // 0x78
+        {"BIT 7,C", 2, 8, 8},         // 0x79
+        {"BIT 7,D", 2, 8, 8},         // 0x7A
+        {"BIT 7,E", 2, 8, 8},         // 0x7B
+        {"BIT 7,H", 2, 8, 8},         // 0x7C
+        {"BIT 7,L", 2, 8, 8},         // 0x7D
+        {"BIT 7,(HL)", 2, 12, 12},    // 0x7E
+        {"BIT 7,A", 2, 8, 8},         // 0x7F
+        {"RES 0,B", 2, 8, 8},         // 0x80
+        {"RES 0,C", 2, 8, 8},         // 0x81
+        {"RES 0,D", 2, 8, 8},         // 0x82
+        {"RES 0,E", 2, 8, 8},         // 0x83
+        {"RES 0,H", 2, 8, 8},         // 0x84
+        {"RES 0,L", 2, 8, 8},         // 0x85
+        {"RES 0,(HL)", 2, 16, 16},    // 0x86
+        {"RES 0,A", 2, 8, 8},         // 0x87
+        {"RES 1,B", 2, 8, 8},         // 0x88
+        {"RES 1,C", 2, 8, 8},         // 0x89
+        {"RES 1,D", 2, 8, 8},         // 0x8A
+        {"RES 1,E", 2, 8, 8},         // 0x8B
+        {"RES 1,H", 2, 8, 8},         // 0x8C
+        {"RES 1,L", 2, 8, 8},         // 0x8D
+        {"RES 1,(HL)", 2, 16, 16},    // 0x8E
+        {"RES 1,A", 2, 8, 8},         // 0x8F
+        {"RES 2,B", 2, 8, 8},         // 0x90
+        {"RES 2,C", 2, 8, 8},         // 0x91
+        {"RES 2,D", 2, 8, 8},         // 0x92
+        {"RES 2,E", 2, 8, 8},         // 0x93
+        {"RES 2,H", 2, 8, 8},         // 0x94
+        {"RES 2,L", 2, 8, 8},         // 0x95
+        {"RES 2,(HL)", 2, 16, 16},    // 0x96
+        {"RES 2,A", 2, 8, 8},         // 0x97
+        {"RES 3,B", 2, 8, 8},         // 0x98
+        {"RES 3,C", 2, 8, 8},         // 0x99
+        {"RES 3,D", 2, 8, 8},         // 0x9A
+        {"RES 3,E", 2, 8, 8},         // 0x9B
+        {"RES 3,H", 2, 8, 8},         // 0x9C
+        {"RES 3,L", 2, 8, 8},         // 0x9D
+        {"RES 3,(HL)", 2, 16, 16},    // 0x9E
+        {"RES 3,A", 2, 8, 8},         // 0x9F
+        {"RES 4,B", 2, 8, 8},         // 0xA0
+        {"RES 4,C", 2, 8, 8},         // 0xA1
+        {"RES 4,D", 2, 8, 8},         // 0xA2
+        {"RES 4,E", 2, 8, 8},         // 0xA3
+        {"RES 4,H", 2, 8, 8},         // 0xA4
+        {"RES 4,L", 2, 8, 8},         // 0xA5
+        {"RES 4,(HL)", 2, 16, 16},    // 0xA6
+        {"RES 4,A", 2, 8, 8},         // 0xA7
+        {"RES 5,B", 2, 8, 8},         // 0xA8
+        {"RES 5,C", 2, 8, 8},         // 0xA9
+        {"RES 5,D", 2, 8, 8},         // 0xAA
+        {"RES 5,E", 2, 8, 8},         // 0xAB
+        {"RES 5,H", 2, 8, 8},         // 0xAC
+        {"RES 5,L", 2, 8, 8},         // 0xAD
+        {"RES 5,(HL)", 2, 16, 16},    // 0xAE
+        {"RES 5,A", 2, 8, 8},         // 0xAF
+        {"RES 6,B", 2, 8, 8},         // 0xB0
+        {"RES 6,C", 2, 8, 8},         // 0xB1
+        {"RES 6,D", 2, 8, 8},         // 0xB2
+        {"RES 6,E", 2, 8, 8},         // 0xB3
+        {"RES 6,H", 2, 8, 8},         // 0xB4
+        {"RES 6,L", 2, 8, 8},         // 0xB5
+        {"RES 6,(HL)", 2, 16, 16},    // 0xB6
+        {"RES 6,A", 2, 8, 8},         // 0xB7
+        {"RES 7,B", 2, 8, 8},         // 0xB8
+        {"RES 7,C", 2, 8, 8},         // 0xB9
+        {"RES 7,D", 2, 8, 8},         // 0xBA
+        {"RES 7,E", 2, 8, 8},         // 0xBB
+        {"RES 7,H", 2, 8, 8},         // 0xBC
+        {"RES 7,L", 2, 8, 8},         // 0xBD
+        {"RES 7,(HL)", 2, 16, 16},    // 0xBE
+        {"RES 7,A", 2, 8, 8},         // 0xBF
+        {"SET 0,B", 2, 8, 8},         // 0xC0
+        {"SET 0,C", 2, 8, 8},         // 0xC1
+        {"SET 0,D", 2, 8, 8},         // 0xC2
+        {"SET 0,E", 2, 8, 8},         // 0xC3
+        {"SET 0,H", 2, 8, 8},         // 0xC4
+        {"SET 0,L", 2, 8, 8},         // 0xC5
+        {"SET 0,(HL)", 2, 16, 16},    // 0xC6
+        {"SET 0,A", 2, 8, 8},         // 0xC7
+        {"SET 1,B", 2, 8, 8},         // 0xC8
+        {"SET 1,C", 2, 8, 8},         // 0xC9
+        {"SET 1,D", 2, 8, 8},         // 0xCA
+        {"SET 1,E", 2, 8, 8},         // 0xCB
+        {"SET 1,H", 2, 8, 8},         // 0xCC
+        {"SET 1,L", 2, 8, 8},         // 0xCD
+        {"SET 1,(HL)", 2, 16, 16},    // 0xCE
+        {"SET 1,A", 2, 8, 8},         // 0xCF
+        {"SET 2,B", 2, 8, 8},         // 0xD0
+        {"SET 2,C", 2, 8, 8},         // 0xD1
+        {"SET 2,D", 2, 8, 8},         // 0xD2
+        {"SET 2,E", 2, 8, 8},         // 0xD3
+        {"SET 2,H", 2, 8, 8},         // 0xD4
+        {"SET 2,L", 2, 8, 8},         // 0xD5
+        {"SET 2,(HL)", 2, 16, 16},    // 0xD6
+        {"SET 2,A", 2, 8, 8},         // 0xD7
+        {"SET 3,B", 2, 8, 8},         // 0xD8
+        {"SET 3,C", 2, 8, 8},         // 0xD9
+        {"SET 3,D", 2, 8, 8},         // 0xDA
+        {"SET 3,E", 2, 8, 8},         // 0xDB
+        {"SET 3,H", 2, 8, 8},         // 0xDC
+        {"SET 3,L", 2, 8, 8},         // 0xDD
+        {"SET 3,(HL)", 2, 16, 16},    // 0xDE
+        {"SET 3,A", 2, 8, 8},         // 0xDF
+        {"SET 4,B", 2, 8, 8},         // 0xE0
+        {"SET 4,C", 2, 8, 8},         // 0xE1
+        {"SET 4,D", 2, 8, 8},         // 0xE2
+        {"SET 4,E", 2, 8, 8},         // 0xE3
+        {"SET 4,H", 2, 8, 8},         // 0xE4
+        {"SET 4,L", 2, 8, 8},         // 0xE5
+        {"SET 4,(HL)", 2, 16, 16},    // 0xE6
+        {"SET 4,A", 2, 8, 8},         // 0xE7
+        {"SET 5,B", 2, 8, 8},         // 0xE8
+        {"SET 5,C", 2, 8, 8},         // 0xE9
+        {"SET 5,D", 2, 8, 8},         // 0xEA
+        {"SET 5,E", 2, 8, 8},         // 0xEB
+        {"SET 5,H", 2, 8, 8},         // 0xEC
+        {"SET 5,L", 2, 8, 8},         // 0xED
+        {"SET 5,(HL)", 2, 16, 16},    // 0xEE
+        {"SET 5,A", 2, 8, 8},         // 0xEF
+        {"SET 6,B", 2, 8, 8},         // 0xF0
+        {"SET 6,C", 2, 8, 8},         // 0xF1
+        {"SET 6,D", 2, 8, 8},         // 0xF2
+        {"SET 6,E", 2, 8, 8},         // 0xF3
+        {"SET 6,H", 2, 8, 8},         // 0xF4
+        {"SET 6,L", 2, 8, 8},         // 0xF5
+        {"SET 6,(HL)", 2, 16, 16},    // 0xF6
+        {"SET 6,A", 2, 8, 8},         // 0xF7
+        {"SET 7,B", 2, 8, 8},         // 0xF8
+        {"SET 7,C", 2, 8, 8},         // 0xF9
+        {"SET 7,D", 2, 8, 8},         // 0xFA
+        {"SET 7,E", 2, 8, 8},         // 0xFB
+        {"SET 7,H", 2, 8, 8},         // 0xFC
+        {"SET 7,L", 2, 8, 8},         // 0xFD
+        {"SET 7,(HL)", 2, 16, 16},    // 0xFE
+        {"SET 7,A", 2, 8, 8}          // 0xFF
+    }};
+
+    // Longest an instruction can take, next is the byte after the opcode (the extended opcode after 0xCB)
+    constexpr u8 getMaxCycles(const u8 opcode, const u8 next)
+    {
+        if(opcode == 0xCB)
+            return extended[next].cycles;
+
+        return base[opcode].cycles > base[opcode].branchCycles ? base[opcode].cycles : base[opcode].branchCycles;
+    }
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+// Configuration of one GameBoy. Every component reads it through a reference to the copy its
+// GameBoy owns, so instances with different options can run side by side.
+struct Options
+{
+    bool skipBootROM = false;
+
+    // Fast-forward busy-wait loops that poll registers only scheduled events change
+    bool idleLoopDetection = true;
+
+    // Keep battery-backed cart RAM in a .sav file next to the ROM, read when the ROM is loaded.
+    // Off by default so headless instances never write next to the ROM. Only one instance holds
+    // a .sav at a time, others loading the same ROM get RAM of their own.
+    bool batterySaves = false;
+
+    #ifdef CPU_JIT
+        // Check every compiled block against the interpreter, slow
+        bool jitLockstep = false;
+    #endif
+};
\ No newline at end of file
@@ -1,11 +1,12 @@
 #include "ppu.h"
 
 #include <string>
+#include <string.h>
 #include <algorithm>
-#include <vector>
 #include "gameboy.h"
+#include "decode.h"
 
-PPU::PPU(Bus& bus, Interrupts& interrupts) : bus(bus), interrupts(interrupts)
+PPU::PPU(Bus& bus, Interrupts& interrupts, Scheduler& scheduler, const Options& options) : render(true), bus(bus), interrupts(interrupts), scheduler(scheduler), options(options)
 {
     this->restart();
 }
@@ -14,8 +15,10 @@ void PPU::restart()
 {
     this->mode = Mode::OAM;
     this->framebuffer.fill(0);
+    this->dirtyTiles.fill(true);
+    this->spritesDirty = true;
 
-    if(GameBoy::skipBootROM)
+    if(this->options.skipBootROM)
     {
         this->lcdc = 0x91;
         this->scx = 0;
@@ -29,7 +32,6 @@ void PPU::restart()
         this->bgp = 0xFC;
         this->obp0 = 0;
         this->obp1 = 0;
-        this->cycleCounter = 0;
     }
     else
     {
@@ -45,8 +47,58 @@ void PPU::restart()
         this->bgp = 0x00;
         this->obp0 = 0;
         this->obp1 = 0;
-        this->cycleCounter = 0;
     }
+
+    this->modeStart = this->scheduler.now;
+    this->suspendedCycles = 0;
+
+    if(this->getControlBit(ControlBit::LCDEnable))
+        this->scheduleNextMode();
+    else
+        this->scheduler.cancel(Scheduler::Event::PPU);
+}
+
+void PPU::saveState(StateWriter& state) const
+{
+    state.write(this->mode);
+    state.write(this->lcdc);
+    state.write(this->scx);
+    state.write(this->scy);
+    state.write(this->wx);
+    state.write(this->wy);
+    state.write(this->windowInternalLineCounter);
+    state.write(this->ly);
+    state.write(this->lyc);
+    state.write(this->stat);
+    state.write(this->bgp);
+    state.write(this->obp0);
+    state.write(this->obp1);
+    state.write(this->modeStart);
+    state.write(this->suspendedCycles);
+    state.write(this->framebuffer);
+}
+
+void PPU::loadState(StateReader& state)
+{
+    state.read(this->mode);
+    state.read(this->lcdc);
+    state.read(this->scx);
+    state.read(this->scy);
+    state.read(this->wx);
+    state.read(this->wy);
+    state.read(this->windowInternalLineCounter);
+    state.read(this->ly);
+    state.read(this->lyc);
+    state.read(this->stat);
+    state.read(this->bgp);
+    state.read(this->obp0);
+    state.read(this->obp1);
+    state.read(this->modeStart);
+    state.read(this->suspendedCycles);
+    state.read(this->framebuffer);
+
+    this->dirtyTiles.fill(true);
+    this->spritesDirty = true;
 }
 
 // =================================================================================
@@ -83,22 +135,160 @@ void PPU::compareScanline()
     }
 }
 
+void PPU::invalidateTile(const u16 addr)
+{
+    this->dirtyTiles[(addr - 0x8000) / 16] = true;
+}
+
+void PPU::decodeTile(const u16 tile)
+{
+    Decode::rows(&this->bus.vram[tile * 16], &this->decodedTiles[tile * 64], 8);
+
+    // Reversing the 8 pixels of a row, compilers turn this into a byte swap
+    const u8* decoded = &this->decodedTiles[tile * 64];
+    u8* flipped = &this->decodedTilesFlipped[tile * 64];
+
+    for(u8 row = 0; row < 8; ++row)
+        for(u8 col = 0; col < 8; ++col)
+            flipped[row * 8 + col] = decoded[row * 8 + 7 - col];
+
+    this->dirtyTiles[tile] = false;
+}
+
+void PPU::decodeTileMapLine(const u16 tileMapStartAddress, const u8 tileRow, const u8 firstTileCol, const u8 pixelRowInTile, const u8 tileCount, u8* pixels)
+{
+    const u8* tileMap = &this->bus.vram[tileMapStartAddress - 0x8000 + tileRow * 32];
+    const bool unsignedTileData = this->getControlBit(ControlBit::BackgroundAndWindowTileDataArea);
+
+    // Gather the bitplanes of every tile on the line and decode them in one pass
+    u8 planes[21 * 2];
+    for(u8 i = 0; i < tileCount; ++i)
+    {
+        const u8 tileIndex = tileMap[(firstTileCol + i) % 32];
+        const u16 tile = unsignedTileData ? tileIndex : 256 + static_cast<i8>(tileIndex);
+
+        planes[i * 2] = this->bus.vram[tile * 16 + pixelRowInTile * 2];
+        planes[i * 2 + 1] = this->bus.vram[tile * 16 + pixelRowInTile * 2 + 1];
+    }
+
+    Decode::rows(planes, pixels, tileCount);
+}
+
+const u8* PPU::getTileRow(const u16 tile, const u8 row, const bool flipX)
+{
+    if(this->dirtyTiles[tile])
+        this->decodeTile(tile);
+
+    return flipX ? &this->decodedTilesFlipped[tile * 64 + row * 8] : &this->decodedTiles[tile * 64 + row * 8];
+}
+
+void PPU::invalidateSprites()
+{
+    this->spritesDirty = true;
+}
+
+void PPU::bucketSprites()
+{
+    const u8 spriteHeight = this->getControlBit(ControlBit::ObjectSize) ? 16 : 8;
+
+    this->lineSpriteCounts.fill(0);
+
+    // The first 10 sprites in OAM order that cover a line are the ones drawn on it
+    for(u8 i = 0; i < 40; ++i)
+    {
+        // Sprites can start above the top of the screen
+        const i16 yPos = this->bus.oam[i * 4] - 16;
+
+        for(i16 line = yPos < 0 ? 0 : yPos; line < yPos + spriteHeight && line < 144; ++line)
+        {
+            if(this->lineSpriteCounts[line] < 10)
+                this->lineSprites[line * 10 + this->lineSpriteCounts[line]++] = i;
+        }
+    }
+
+    // Sort each line by priority: lower X first, then lower OAM index
+    for(u8 line = 0; line < 144; ++line)
+    {
+        u8* sprites = &this->lineSprites[line * 10];
+
+        for(u8 i = 1; i < this->lineSpriteCounts[line]; ++i)
+        {
+            const u8 sprite = sprites[i];
+            const u8 x = this->bus.oam[sprite * 4 + 1];
+
+            u8 j = i;
+            for(; j > 0 && this->bus.oam[sprites[j - 1] * 4 + 1] > x; --j)
+                sprites[j] = sprites[j - 1];
+
+            sprites[j] = sprite;
+        }
+    }
+
+    this->spritesDirty = false;
+}
+
+void PPU::writeLCDC(const u8 val)
+{
+    if((this->lcdc ^ val) & static_cast<u8>(ControlBit::ObjectSize))
+        this->invalidateSprites();
+
+    const bool wasEnabled = this->getControlBit(ControlBit::LCDEnable);
+    this->lcdc = val;
+    const bool enabled = this->getControlBit(ControlBit::LCDEnable);
+
+    // The mode timer is frozen while the LCD is off and resumes where it left off
+    if(wasEnabled && !enabled)
+    {
+        this->suspendedCycles = this->scheduler.now - this->modeStart;
+        this->scheduler.cancel(Scheduler::Event::PPU);
+    }
+    else if(!wasEnabled && enabled)
+    {
+        this->modeStart = this->scheduler.now - this->suspendedCycles;
+        this->scheduleNextMode();
+    }
+}
+
+u32 PPU::getModeDuration() const
+{
+    switch(this->mode)
+    {
+        case Mode::HBlank:
+            return 204;
+        case Mode::VBlank:
+            return 456;
+        case Mode::OAM:
+            return 80;
+        default:
+            return 172;
+    }
+}
+
+void PPU::scheduleNextMode()
+{
+    this->scheduler.schedule(Scheduler::Event::PPU, this->modeStart + this->getModeDuration());
+}
+
 // =================================================================================
 // Scanline Modes
 // =================================================================================
 
 void PPU::updateHBlankPeriod()
 {
-    if(this->cycleCounter <= 204)
-        return;
-
     // If mode 0 for the STAT interrupt is enabled, fire a STAT interrupt
     if(this->stat & 0x08)
         this->interrupts.setFlag(Interrupts::Interrupt::LCD, true);
 
-    this->drawBackgroundScanline();
-    this->drawWindowScanline();
-    this->drawSpritesScanline();
+    if(this->render)
+    {
+        this->drawBackgroundScanline();
+        this->drawWindowScanline();
+        this->drawSpritesScanline();
+    }
+    else if(this->isWindowOnScanline())
+    {
+        ++this->windowInternalLineCounter;
+    }
 
     ++this->ly;
     this->compareScanline();
@@ -109,15 +299,10 @@ void PPU::updateHBlankPeriod()
         this->mode = Mode::VBlank;
         this->interrupts.setFlag(Interrupts::Interrupt::VBlank, true);
     }
-
-    this->cycleCounter -= 204;
 }
 
 void PPU::updateVBlankPeriod()
 {
-    if(this->cycleCounter <= 456)
-        return;
-
     // If mode 1 for the STAT interrupt is enabled, fire a STAT interrupt
     if(this->stat & 0x10)
         this->interrupts.setFlag(Interrupts::Interrupt::LCD, true);
@@ -133,30 +318,20 @@ void PPU::updateVBlankPeriod()
         this->compareScanline();
         this->windowInternalLineCounter = 0;
     }
-
-    this->cycleCounter -= 456;
 }
 
 void PPU::updateOAMScan()
 {
-    if(this->cycleCounter <= 80)
-        return;
-
     // If mode 2 for the STAT interrupt is enabled, fire a STAT interrupt
     if(this->stat & 0x20)
         this->interrupts.setFlag(Interrupts::Interrupt::LCD, true);
 
     this->mode = Mode::Transfer;
-    this->cycleCounter -= 80;
 }
 
 void PPU::updateTransfer()
 {
-    if(this->cycleCounter <= 172)
-        return;
-
     this->mode = Mode::HBlank;
-    this->cycleCounter -= 172;
 }
 
 // =================================================================================
@@ -165,35 +340,20 @@ void PPU::updateTransfer()
 
 void PPU::drawBackgroundScanline()
 {
-    const u8 palette[4][3] =
-    {
-        // {0xFF, 0xFF, 0xFF},
-        // {0xAA, 0xAA, 0xAA},
-        // {0x55, 0x55, 0x55},
-        // {0x00, 0x00, 0x00}
-        {154, 158, 63},
-        {73, 107, 34},
-        {14, 69, 11},
-        {27, 42, 9}
-    };
-
-    u8 backgroundColors[4][3];
+    u8 backgroundShades[4];
     for(u8 i = 0; i < 4; ++i)
     {
-        u8 colorIndex = (this->bgp >> (i * 2)) & 0x03;
-        backgroundColors[i][0] = palette[colorIndex][0];
-        backgroundColors[i][1] = palette[colorIndex][1];
-        backgroundColors[i][2] = palette[colorIndex][2];
+        backgroundShades[i] = (this->bgp >> (i * 2)) & 0x03;
     }
 
     if(!this->getControlBit(ControlBit::BackgroundAndWindowEnable))
     {
-        // u32 framebufferOffset = this->ly * 160 * 3;
+        this->backgroundLine.fill(0);
+
+        // u32 framebufferOffset = this->ly * 160;
         // for(u8 screenX = 0; screenX < 160; ++screenX)
         // {
-        //     this->framebuffer[framebufferOffset + screenX * 3] = 0xFF;
-        //     this->framebuffer[framebufferOffset + screenX * 3 + 1] = 0xFF;
-        //     this->framebuffer[framebufferOffset + screenX * 3 + 2] = 0xFF;
+        //     this->framebuffer[framebufferOffset + screenX] = 0;
         // }
         return;
     }
@@ -201,7 +361,7 @@ void PPU::drawBackgroundScanline()
     u16 tileMapStartAddress = this->getControlBit(ControlBit::BackgroundTileMapArea) ? 0x9C00 : 0x9800;
     u16 tileDataStartAddress = this->getControlBit(ControlBit::BackgroundAndWindowTileDataArea) ? 0x8000 : 0x8800;
 
-    u32 framebufferOffset = this->ly * 160 * 3;
+    u32 framebufferOffset = this->ly * 160;
 
     u8 backgroundY = (this->scy + this->ly) % 256;
     u8 tileRow = backgroundY / 8;
@@ -211,58 +371,31 @@ void PPU::drawBackgroundScanline()
     u8 tileCol = backgroundX / 8;
     u8 pixelOffset = backgroundX % 8;
 
-    for(u8 screenX = 0; screenX < 160;)
-    {
-        u16 tileMapOffset = tileMapStartAddress + (tileRow * 32) + tileCol;
-        u8 tileIndex = this->bus.readByte(tileMapOffset);
-
-        u16 tileDataOffset;
-        if(this->getControlBit(ControlBit::BackgroundAndWindowTileDataArea))
-        {
-            tileDataOffset = 0x8000 + (tileIndex * 16);
-        }
-        else
-        {
-            i8 signedTileIndex = static_cast<i8>(tileIndex);
-            tileDataOffset = 0x9000 + (signedTileIndex * 16);
-        }
-
-        u16 tileRowAddress = tileDataOffset + (pixelRowInTile * 2);
-        u8 lowByte = this->bus.readByte(tileRowAddress);
-        u8 highByte = this->bus.readByte(tileRowAddress + 1);
-
-        for(u8 pixel = pixelOffset; pixel < 8 && screenX < 160; ++pixel, ++screenX)
-        {
-            u8 lowBit = (lowByte >> (7 - pixel)) & 1;
-            u8 highBit = (highByte >> (7 - pixel)) & 1;
-            u8 pixelValue = (highBit << 1) | lowBit;
-
-            u32 framebufferPixelOffset = framebufferOffset + screenX * 3;
-            this->framebuffer[framebufferPixelOffset] = backgroundColors[pixelValue][0];
-            this->framebuffer[framebufferPixelOffset + 1] = backgroundColors[pixelValue][1];
-            this->framebuffer[framebufferPixelOffset + 2] = backgroundColors[pixelValue][2];
-        }
+    // Up to 21 tiles are visible when the line does not start on a tile boundary
+    u8 pixels[21 * 8];
+    this->decodeTileMapLine(tileMapStartAddress, tileRow, tileCol, pixelRowInTile, 21, pixels);
 
-        tileCol = (tileCol + 1) % 32;
-        pixelOffset = 0;
-    }
+    memcpy(this->backgroundLine.data(), &pixels[pixelOffset], 160);
+    Decode::palette(this->backgroundLine.data(), &this->framebuffer[framebufferOffset], 160, backgroundShades);
 }
 
-void PPU::drawWindowScanline()
+bool PPU::isWindowOnScanline() const
 {
     if(!this->getControlBit(ControlBit::WindowEnable) || !this->getControlBit(ControlBit::BackgroundAndWindowEnable))
-        return;
+        return false;
 
-    if(this->ly < this->wy)
-        return;
+    return this->ly >= this->wy && this->wx < 167;
+}
 
-    if(this->wx >= 167)
+void PPU::drawWindowScanline()
+{
+    if(!this->isWindowOnScanline())
         return;
         
     u16 tileMapStartAddress = this->getControlBit(ControlBit::WindowTileMapArea) ? 0x9C00 : 0x9800;
     u16 tileDataStartAddress = this->getControlBit(ControlBit::BackgroundAndWindowTileDataArea) ? 0x8000 : 0x8800;
 
-    u32 framebufferOffset = this->ly * 160 * 3;
+    u32 framebufferOffset = this->ly * 160;
 
     u8 windowY = this->windowInternalLineCounter;
     u8 tileRow = windowY / 8;
@@ -278,62 +411,19 @@ void PPU::drawWindowScanline()
         windowX = 0;
     }
 
-    const u8 palette[4][3] =
-    {
-        // {0xFF, 0xFF, 0xFF},
-        // {0xAA, 0xAA, 0xAA},
-        // {0x55, 0x55, 0x55},
-        // {0x00, 0x00, 0x00}
-        {154, 158, 63},
-        {73, 107, 34},
-        {14, 69, 11},
-        {27, 42, 9}
-    };
-
-    u8 windowColors[4][3];
+    u8 windowShades[4];
     for(u8 i = 0; i < 4; ++i)
     {
-        u8 colorIndex = (this->bgp >> (i * 2)) & 0x03;
-        windowColors[i][0] = palette[colorIndex][0];
-        windowColors[i][1] = palette[colorIndex][1];
-        windowColors[i][2] = palette[colorIndex][2];
+        windowShades[i] = (this->bgp >> (i * 2)) & 0x03;
     }
 
-    for(u8 screenX = windowX; screenX < 160;)
-    {
-        u16 tileMapOffset = tileMapStartAddress + (tileRow * 32) + tileCol;
-        u8 tileIndex = this->bus.readByte(tileMapOffset);
-
-        u16 tileDataOffset;
-        if(this->getControlBit(ControlBit::BackgroundAndWindowTileDataArea))
-        {
-            tileDataOffset = 0x8000 + (tileIndex * 16);
-        }
-        else
-        {
-            i8 signedTileIndex = static_cast<i8>(tileIndex);
-            tileDataOffset = 0x9000 + (signedTileIndex * 16);
-        }
-
-        u16 tileRowAddress = tileDataOffset + (pixelRowInTile * 2);
-        u8 lowByte = this->bus.readByte(tileRowAddress);
-        u8 highByte = this->bus.readByte(tileRowAddress + 1);
+    const u8 width = 160 - windowX;
 
-        for(u8 pixel = pixelOffset; pixel < 8 && screenX < 160; ++pixel, ++screenX)
-        {
-            u8 lowBit = (lowByte >> (7 - pixel)) & 1;
-            u8 highBit = (highByte >> (7 - pixel)) & 1;
-            u8 pixelValue = (highBit << 1) | lowBit;
-
-            u32 framebufferPixelOffset = framebufferOffset + screenX * 3;
-            this->framebuffer[framebufferPixelOffset] = windowColors[pixelValue][0];
-            this->framebuffer[framebufferPixelOffset + 1] = windowColors[pixelValue][1];
-            this->framebuffer[framebufferPixelOffset + 2] = windowColors[pixelValue][2];
-        }
+    u8 pixels[21 * 8];
+    this->decodeTileMapLine(tileMapStartAddress, tileRow, tileCol, pixelRowInTile, (pixelOffset + width + 7) / 8, pixels);
 
-        tileCol = (tileCol + 1) % 32;
-        pixelOffset = 0;
-    }
+    memcpy(&this->backgroundLine[windowX], &pixels[pixelOffset], width);
+    Decode::palette(&this->backgroundLine[windowX], &this->framebuffer[framebufferOffset + windowX], width, windowShades);
 
     ++this->windowInternalLineCounter;
 }
@@ -343,165 +433,82 @@ void PPU::drawSpritesScanline()
     if(!getControlBit(ControlBit::ObjectEnable))
         return;
 
-    const u8 palette[2][4][3] = 
+    u8 objectShades[2][4];
+    for(u8 i = 0; i < 4; ++i)
     {
-        {
-            // {0xFF, 0xFF, 0xFF}, // Color 0 (transparent)
-            // {0xAA, 0xAA, 0xAA}, // Color 1
-            // {0x55, 0x55, 0x55}, // Color 2
-            // {0x00, 0x00, 0x00}  // Color 3
-            {154, 158, 63},
-            {73, 107, 34},
-            {14, 69, 11},
-            {27, 42, 9}
-        },
-        {
-            // {0xFF, 0xFF, 0xFF}, // Color 0 (transparent)
-            // {0xAA, 0xAA, 0xAA}, // Color 1
-            // {0x55, 0x55, 0x55}, // Color 2
-            // {0x00, 0x00, 0x00}  // Color 3
-            {154, 158, 63},
-            {73, 107, 34},
-            {14, 69, 11},
-            {27, 42, 9}
-        }
-    };
-
-    u8 objectColors[2][4][3];
-    for (int i = 0; i < 4; ++i) {
-        u8 colorIdx0 = (this->obp0 >> (i * 2)) & 0x03;
-        u8 colorIdx1 = (this->obp1 >> (i * 2)) & 0x03;
-        objectColors[0][i][0] = palette[0][colorIdx0][0];
-        objectColors[0][i][1] = palette[0][colorIdx0][1];
-        objectColors[0][i][2] = palette[0][colorIdx0][2];
-        objectColors[1][i][0] = palette[1][colorIdx1][0];
-        objectColors[1][i][1] = palette[1][colorIdx1][1];
-        objectColors[1][i][2] = palette[1][colorIdx1][2];
+        objectShades[0][i] = (this->obp0 >> (i * 2)) & 0x03;
+        objectShades[1][i] = (this->obp1 >> (i * 2)) & 0x03;
     }
 
-    u8 spriteHeight = getControlBit(ControlBit::ObjectSize) ? 16 : 8;
+    if(this->spritesDirty)
+        this->bucketSprites();
 
-    u32 framebufferOffset = this->ly * 160 * 3;
-
-    struct Sprite
-    {
-        // u8 index;
-        u8 yPos;
-        u8 xPos;
-        u8 tileIndex;
-        u8 flags;
-        // bool active;
-    };
-
-    // Sprite sprites[40];
-    std::vector<Sprite> sprites;
-    u8 numberOfSprites = 0;
-    for(u8 i = 0; i < 40 && numberOfSprites < 10; ++i)
-    {
-        u16 oamBase = 0xFE00 + (i * 4);
-
-        u8 yPos = this->bus.readByte(oamBase) - 16;
-        u8 xPos = this->bus.readByte(oamBase + 1) - 8;
-        u8 tileIndex = this->bus.readByte(oamBase + 2);
-        u8 flags = this->bus.readByte(oamBase + 3);
-
-        if(this->ly < yPos || this->ly >= yPos + spriteHeight)
-        {
-            // sprites[i].active = false;
-            continue;
-        }
-
-        // sprites[i].active = true;
-
-        // sprites[i].yPos = yPos;
-        // sprites[i].xPos = xPos;
-        // sprites[i].tileIndex = tileIndex;
-        // sprites[i].flags = flags;
-
-        Sprite sprite;
-        sprite.yPos = yPos;
-        sprite.xPos = xPos;
-        sprite.tileIndex = tileIndex;
-        sprite.flags = flags;
+    u8 spriteHeight = getControlBit(ControlBit::ObjectSize) ? 16 : 8;
 
-        sprites.push_back(sprite);
+    const u32 framebufferOffset = this->ly * 160;
 
-        ++numberOfSprites;
-    }
+    // The first opaque pixel of the highest priority sprite owns the screen pixel, even when it is hidden behind the background
+    bool pixelTaken[160] = {};
+    bool pixelBehind[160];
+    u8 pixelShades[160];
 
-    // std::stable_sort(std::begin(sprites), std::end(sprites), [](Sprite a, Sprite b){return a.xPos < b.xPos;});
-    // std::stable_sort(sprites.begin(), sprites.end(), [](Sprite a, Sprite b){return a.xPos < b.xPos;});
+    const u8* lineSprites = &this->lineSprites[this->ly * 10];
 
-    for (u8 i = 0; i < sprites.size(); ++i)
+    for(u8 i = 0; i < this->lineSpriteCounts[this->ly]; ++i)
     {
-        // if(!sprites[i].active)
-            // continue;
-
-        // if (this->ly < sprites[i].yPos || this->ly >= sprites[i].yPos + spriteHeight) 
-        //     continue;
+        const u8* sprite = &this->bus.oam[lineSprites[i] * 4];
 
-        for(u8 j = i + 1; j < sprites.size(); ++j)
-        {
-            if(sprites[i].xPos == sprites[j].xPos)
-            {
-                ++i;
-                return;
-            }
-        }
+        u8 yPos = sprite[0] - 16;
+        u8 xPos = sprite[1] - 8;
+        u8 tileIndex = sprite[2];
+        u8 flags = sprite[3];
 
-        bool priority = (sprites[i].flags & 0x80) != 0;
-        bool flipY = (sprites[i].flags & 0x40) != 0;
-        bool flipX = (sprites[i].flags & 0x20) != 0;
-        u8 paletteIndex = (sprites[i].flags & 0x10) ? 1 : 0;
+        bool priority = (flags & 0x80) != 0;
+        bool flipY = (flags & 0x40) != 0;
+        bool flipX = (flags & 0x20) != 0;
+        u8 paletteIndex = (flags & 0x10) ? 1 : 0;
 
-        u8 pixelRow = flipY ? (spriteHeight - 1 - (this->ly - sprites[i].yPos)) : (this->ly - sprites[i].yPos);
+        u8 pixelRow = flipY ? (spriteHeight - 1 - (this->ly - yPos)) : (this->ly - yPos);
 
-        if (spriteHeight == 16 && (sprites[i].tileIndex & 1)) 
-            sprites[i].tileIndex &= ~1;
+        if (spriteHeight == 16) 
+            tileIndex &= ~1;
 
-        u16 tileDataOffset = 0x8000 + (sprites[i].tileIndex * 16) + (pixelRow * 2);
-        u8 lowByte = this->bus.readByte(tileDataOffset);
-        u8 highByte = this->bus.readByte(tileDataOffset + 1);
+        const u8* tileRowPixels = this->getTileRow(tileIndex + pixelRow / 8, pixelRow % 8, flipX);
 
         for (u8 pixel = 0; pixel < 8; ++pixel) 
         {
-            u8 screenX = sprites[i].xPos + pixel;
+            u8 screenX = xPos + pixel;
 
             if (screenX >= 160) 
                 continue;
 
-            u8 pixelIndex = flipX ? (7 - pixel) : pixel;
-            u8 lowBit = (lowByte >> (7 - pixelIndex)) & 1;
-            u8 highBit = (highByte >> (7 - pixelIndex)) & 1;
-            u8 pixelValue = (highBit << 1) | lowBit;
+            u8 pixelValue = tileRowPixels[pixel];
 
-            if (pixelValue == 0) 
+            if (pixelValue == 0 || pixelTaken[screenX]) 
                 continue;
 
-            u32 framebufferPixelOffset = framebufferOffset + screenX * 3;
-            
-            if (priority && this->framebuffer[framebufferPixelOffset] != 154 && this->framebuffer[framebufferPixelOffset] != 158 && this->framebuffer[framebufferPixelOffset] != 63) 
-                continue;
-
-            this->framebuffer[framebufferPixelOffset] = objectColors[paletteIndex][pixelValue][0];
-            this->framebuffer[framebufferPixelOffset + 1] = objectColors[paletteIndex][pixelValue][1];
-            this->framebuffer[framebufferPixelOffset + 2] = objectColors[paletteIndex][pixelValue][2];
+            pixelTaken[screenX] = true;
+            pixelBehind[screenX] = priority;
+            pixelShades[screenX] = objectShades[paletteIndex][pixelValue];
         }
     }
+
+    // Sprites with the priority flag are hidden behind background color indices 1-3
+    u8* line = &this->framebuffer[framebufferOffset];
+    for(u8 screenX = 0; screenX < 160; ++screenX)
+    {
+        const bool visible = pixelTaken[screenX] && !(pixelBehind[screenX] && this->backgroundLine[screenX]);
+        line[screenX] = visible ? pixelShades[screenX] : line[screenX];
+    }
 }
 
 // =================================================================================
 // Main Logic
 // =================================================================================
 
-void PPU::step(const u8 cycles)
+void PPU::step()
 {
-    if(!this->getControlBit(ControlBit::LCDEnable))
-        return;
-
-    this->cycleCounter += cycles;
-
-    this->stat = (this->stat & 0xFC) | static_cast<u8>(this->mode);
+    this->modeStart += this->getModeDuration();
 
     switch(this->mode)
     {
@@ -518,4 +525,73 @@ void PPU::step(const u8 cycles)
             this->updateTransfer();
             break;
     }
+
+    this->stat = (this->stat & 0xFC) | static_cast<u8>(this->mode);
+
+    this->scheduleNextMode();
+}
+
+std::span<const u8> PPU::getFramebuffer(PixelFormat format)
+{
+    const u8 palette[4][3] =
+    {
+        // {0xFF, 0xFF, 0xFF},
+        // {0xAA, 0xAA, 0xAA},
+        // {0x55, 0x55, 0x55},
+        // {0x00, 0x00, 0x00}
+        {154, 158, 63},
+        {73, 107, 34},
+        {14, 69, 11},
+        {27, 42, 9}
+    };
+
+    u8* output = this->convertedFramebuffer.data();
+
+    switch(format)
+    {
+        case PixelFormat::RGB24:
+        {
+            for(u32 i = 0; i < 160 * 144; ++i)
+            {
+                memcpy(&output[i * 3], palette[this->framebuffer[i]], 3);
+            }
+
+            return std::span<const u8>(output, 160 * 144 * 3);
+        }
+        case PixelFormat::RGBA8888:
+        case PixelFormat::ARGB8888:
+        {
+            u32 colors[4];
+            for(u8 i = 0; i < 4; ++i)
+            {
+                if(format == PixelFormat::RGBA8888)
+                    colors[i] = (palette[i][0] << 24) | (palette[i][1] << 16) | (palette[i][2] << 8) | 0xFF;
+                else
+                    colors[i] = (0xFFu << 24) | (palette[i][0] << 16) | (palette[i][1] << 8) | palette[i][2];
+            }
+
+            for(u32 i = 0; i < 160 * 144; ++i)
+            {
+                memcpy(&output[i * 4], &colors[this->framebuffer[i]], 4);
+            }
+
+            return std::span<const u8>(output, 160 * 144 * 4);
+        }
+        case PixelFormat::RGB565:
+        default:
+        {
+            u16 colors[4];
+            for(u8 i = 0; i < 4; ++i)
+            {
+                colors[i] = ((palette[i][0] >> 3) << 11) | ((palette[i][1] >> 2) << 5) | (palette[i][2] >> 3);
+            }
+
+            for(u32 i = 0; i < 160 * 144; ++i)
+            {
+                memcpy(&output[i * 2], &colors[this->framebuffer[i]], 2);
+            }
+
+            return std::span<const u8>(output, 160 * 144 * 2);
+        }
+    }
 }
\ No newline at end of file
@@ -1,12 +1,26 @@
 #pragma once
 
 #include <array>
+#include <span>
 #include "types.h"
+#include "state.h"
+#include "options.h"
 #include "bus.h"
 #include "interrupts.h"
+#include "scheduler.h"
 
 class PPU
 {
+    public:
+        // Output formats for getFramebuffer, 32 and 16-bit formats are packed native-endian words like SDL's
+        enum class PixelFormat : u8
+        {
+            RGB24,
+            RGBA8888,
+            ARGB8888,
+            RGB565,
+        };
+
     private:
         enum class Color : u8
         {
@@ -55,12 +69,35 @@ class PPU
         u8 obp0;
         u8 obp1;
 
-        u32 cycleCounter;
+        // Cycle at which the current mode began, and how far into it the PPU was when the LCD was switched off
+        u64 modeStart;
+        u32 suspendedCycles;
+
+        // Shade (0-3) of every pixel after the BGP/OBP palettes, converted to colors once per frame
+        std::array<u8, 160 * 144> framebuffer;
+        alignas(4) std::array<u8, 160 * 144 * 4> convertedFramebuffer;
+
+        // Background/window color index (before BGP) of each pixel on the current line, for sprite priority
+        std::array<u8, 160> backgroundLine;
+
+        // The 384 tiles at 0x8000-0x97FF decoded to one color index per pixel, in normal and X-flipped
+        // order. A tile is decoded again the next time it is drawn after a VRAM write touched it.
+        std::array<u8, 384 * 64> decodedTiles;
+        std::array<u8, 384 * 64> decodedTilesFlipped;
+        std::array<bool, 384> dirtyTiles;
+
+        // OAM indices of the sprites on each line in drawing priority order, rebuilt after OAM or the sprite size changes
+        std::array<u8, 144 * 10> lineSprites;
+        std::array<u8, 144> lineSpriteCounts;
+        bool spritesDirty;
 
-        std::array<u8, 160 * 144 * 3> framebuffer;
+        // Cleared for run-ahead frames nobody sees, scanlines then only advance the window line counter
+        bool render;
 
         Interrupts& interrupts;
         Bus& bus;
+        Scheduler& scheduler;
+        const Options& options;
         friend class Bus;
         friend class GameBoy;
 
@@ -69,19 +106,41 @@ class PPU
 
         void compareScanline();
 
+        void invalidateTile(const u16 addr);
+        void decodeTile(const u16 tile);
+        const u8* getTileRow(const u16 tile, const u8 row, const bool flipX);
+        void decodeTileMapLine(const u16 tileMapStartAddress, const u8 tileRow, const u8 firstTileCol, const u8 pixelRowInTile, const u8 tileCount, u8* pixels);
+
+        void invalidateSprites();
+        void bucketSprites();
+
+        void writeLCDC(const u8 val);
+
+        u32 getModeDuration() const;
+        void scheduleNextMode();
+
         void updateHBlankPeriod();
         void updateVBlankPeriod();
         void updateOAMScan();
         void updateTransfer();
 
+        bool isWindowOnScanline() const;
+
         void drawBackgroundScanline();
         void drawWindowScanline();
         void drawSpritesScanline();
 
     public:
-        PPU(Bus& bus, Interrupts& interrupts);
+        PPU(Bus& bus, Interrupts& interrupts, Scheduler& scheduler, const Options& options);
 
         void restart();
 
-        void step(const u8 cycles);
+        // Decoded tiles and sprite buckets are rebuilt from VRAM and OAM after a load
+        void saveState(StateWriter& state) const;
+        void loadState(StateReader& state);
+
+        // Scheduler event, fires when the current mode ends
+        void step();
+
+        std::span<const u8> getFramebuffer(PixelFormat format);
 };
\ No newline at end of file
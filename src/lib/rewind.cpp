@@ -0,0 +1,297 @@
+#include "rewind.h"
+
+#include <string.h>
+#include <algorithm>
+#include "gameboy.h"
+
+Rewind::Rewind(const u16 interval, const size_t capacity) : interval(std::max<u16>(interval, 1)), frames(0), ring(capacity), head(0), tail(0), used(0), count(0), pendingHead(0), pendingCount(0), stats({0, 0, 0, 0}), busy(false), stop(false), worker(&Rewind::work, this)
+{
+
+}
+
+Rewind::~Rewind()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+    }
+
+    this->wake.notify_all();
+    this->worker.join();
+}
+
+void Rewind::clear()
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->idle.wait(lock, [this]() { return !this->busy && !this->pendingCount; });
+
+    this->head = 0;
+    this->tail = 0;
+    this->used = 0;
+    this->count = 0;
+    this->latest.clear();
+    this->frames = 0;
+}
+
+void Rewind::frame(const GameBoy& gameboy)
+{
+    if(++this->frames < this->interval)
+        return;
+
+    this->frames = 0;
+
+    {
+        // The worker only holds the lock to swap buffers and append to the ring
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        if(this->pendingCount == Rewind::pendingSlots)
+        {
+            ++this->stats.skipped;
+            return;
+        }
+
+        std::vector<u8>& snapshot = this->pending[(this->pendingHead + this->pendingCount) % Rewind::pendingSlots];
+        snapshot.resize(gameboy.getStateSize());
+        gameboy.saveState(snapshot);
+        ++this->pendingCount;
+        ++this->stats.snapshots;
+    }
+
+    this->wake.notify_one();
+}
+
+bool Rewind::rewind(GameBoy& gameboy)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->idle.wait(lock, [this]() { return !this->busy && !this->pendingCount; });
+
+    if(!this->pop(this->delta))
+        return false;
+
+    this->applyDelta(this->delta);
+    this->frames = 0;
+
+    return gameboy.loadState(this->latest);
+}
+
+Rewind::Stats Rewind::getStats()
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    Stats stats = this->stats;
+    stats.history = this->count;
+    stats.bytes = this->used;
+
+    return stats;
+}
+
+// =================================================================================
+// Worker
+// =================================================================================
+
+void Rewind::work()
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    while(true)
+    {
+        this->wake.wait(lock, [this]() { return this->stop || this->pendingCount; });
+
+        if(this->stop)
+            return;
+
+        std::swap(this->pending[this->pendingHead], this->incoming);
+        this->pendingHead = (this->pendingHead + 1) % Rewind::pendingSlots;
+        --this->pendingCount;
+        this->busy = true;
+
+        // A different state size means another ROM, the old history can't lead here
+        const bool chained = this->latest.size() == this->incoming.size();
+
+        lock.unlock();
+
+        if(chained)
+            this->encodeDelta();
+
+        lock.lock();
+
+        if(chained)
+            this->push(this->delta);
+        else
+            this->head = this->tail = this->used = this->count = 0;
+
+        std::swap(this->latest, this->incoming);
+        this->busy = false;
+        this->idle.notify_all();
+    }
+}
+
+// =================================================================================
+// Delta Coding
+// =================================================================================
+
+// A delta is the XOR of two snapshots as pairs of varints, the number of unchanged bytes to
+// skip and the number of changed bytes that follow, then those bytes. Unchanged bytes at the
+// end are left out.
+void Rewind::encodeDelta()
+{
+    const size_t size = this->incoming.size();
+    const u8* a = this->latest.data();
+    const u8* b = this->incoming.data();
+
+    // Worst case is a varint pair for every changed byte, the capacity is kept across snapshots
+    this->delta.resize(size * 3 + 16);
+    u8* out = this->delta.data();
+
+    const auto writeVarint = [&out](size_t val)
+    {
+        while(val >= 0x80)
+        {
+            *out++ = (val & 0x7F) | 0x80;
+            val >>= 7;
+        }
+        *out++ = val;
+    };
+
+    size_t i = 0;
+    while(i < size)
+    {
+        const size_t unchanged = i;
+
+        while(i + 8 <= size && memcmp(a + i, b + i, 8) == 0)
+            i += 8;
+
+        while(i < size && a[i] == b[i])
+            ++i;
+
+        if(i == size)
+            break;
+
+        writeVarint(i - unchanged);
+
+        // Single unchanged bytes are cheaper to keep in the run than to start a new pair for
+        const size_t changed = i;
+        while(i < size && (a[i] != b[i] || (i + 1 < size && a[i + 1] != b[i + 1])))
+            ++i;
+
+        writeVarint(i - changed);
+
+        for(size_t j = changed; j < i; ++j)
+            *out++ = a[j] ^ b[j];
+    }
+
+    this->delta.resize(out - this->delta.data());
+}
+
+void Rewind::applyDelta(const std::vector<u8>& delta)
+{
+    const u8* in = delta.data();
+    const u8* end = in + delta.size();
+
+    const auto readVarint = [&in]()
+    {
+        size_t val = 0;
+        u8 shift = 0;
+        u8 byte;
+
+        do
+        {
+            byte = *in++;
+            val |= static_cast<size_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while(byte & 0x80);
+
+        return val;
+    };
+
+    size_t position = 0;
+    while(in < end)
+    {
+        position += readVarint();
+        const size_t changed = readVarint();
+
+        for(size_t i = 0; i < changed; ++i)
+            this->latest[position++] ^= *in++;
+    }
+}
+
+// =================================================================================
+// Ring
+// =================================================================================
+
+void Rewind::copyToRing(size_t position, const u8* data, const size_t size)
+{
+    position %= this->ring.size();
+
+    const size_t first = std::min(size, this->ring.size() - position);
+    memcpy(&this->ring[position], data, first);
+    memcpy(&this->ring[0], data + first, size - first);
+}
+
+void Rewind::copyFromRing(size_t position, u8* data, const size_t size) const
+{
+    position %= this->ring.size();
+
+    const size_t first = std::min(size, this->ring.size() - position);
+    memcpy(data, &this->ring[position], first);
+    memcpy(data + first, &this->ring[0], size - first);
+}
+
+void Rewind::push(const std::vector<u8>& delta)
+{
+    const u32 size = delta.size();
+    const size_t entry = size + 2 * sizeof(u32);
+
+    // Without this delta nothing older can be reached either
+    if(entry > this->ring.size())
+    {
+        this->head = this->tail = this->used = this->count = 0;
+        return;
+    }
+
+    while(this->used + entry > this->ring.size())
+        this->dropOldest();
+
+    this->copyToRing(this->head, reinterpret_cast<const u8*>(&size), sizeof(u32));
+    this->copyToRing(this->head + sizeof(u32), delta.data(), size);
+    this->copyToRing(this->head + sizeof(u32) + size, reinterpret_cast<const u8*>(&size), sizeof(u32));
+
+    this->head = (this->head + entry) % this->ring.size();
+    this->used += entry;
+    ++this->count;
+}
+
+bool Rewind::pop(std::vector<u8>& delta)
+{
+    if(!this->count)
+        return false;
+
+    const size_t capacity = this->ring.size();
+
+    u32 size;
+    this->copyFromRing(this->head + capacity - sizeof(u32), reinterpret_cast<u8*>(&size), sizeof(u32));
+
+    const size_t entry = size + 2 * sizeof(u32);
+    const size_t start = (this->head + capacity - entry) % capacity;
+
+    delta.resize(size);
+    this->copyFromRing(start + sizeof(u32), delta.data(), size);
+
+    this->head = start;
+    this->used -= entry;
+    --this->count;
+
+    return true;
+}
+
+void Rewind::dropOldest()
+{
+    u32 size;
+    this->copyFromRing(this->tail, reinterpret_cast<u8*>(&size), sizeof(u32));
+
+    const size_t entry = size + 2 * sizeof(u32);
+
+    this->tail = (this->tail + entry) % this->ring.size();
+    this->used -= entry;
+    --this->count;
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "types.h"
+
+class GameBoy;
+
+// Rewind history. Every interval frames the emulation thread copies a save state into a
+// pending buffer and a worker thread XORs it against the previous snapshot, run-length
+// encodes the zeros away and appends the result to a fixed-size byte ring. Only the newest
+// snapshot is kept whole, older ones are reached by applying the deltas backwards. When the
+// ring is full the oldest deltas are dropped.
+class Rewind
+{
+    public:
+        struct Stats
+        {
+            u64 snapshots;      // Snapshots taken
+            u64 skipped;        // Snapshots not taken because the worker was still busy
+            u32 history;        // Snapshots that can be rewound to
+            size_t bytes;       // Ring bytes those take
+        };
+
+    private:
+        u16 interval;
+        u16 frames;
+
+        // Deltas from newest to the snapshot before it, each stored as size, payload, size so the
+        // ring can be trimmed at the tail and popped at the head
+        std::vector<u8> ring;
+        size_t head;
+        size_t tail;
+        size_t used;
+        u32 count;
+
+        // Newest whole snapshot
+        std::vector<u8> latest;
+
+        // Queue of snapshots handed from the emulation thread to the worker, a few slots absorb
+        // the worker's wake-up latency when frames run faster than real time
+        static constexpr u8 pendingSlots = 4;
+
+        std::array<std::vector<u8>, pendingSlots> pending;
+        u8 pendingHead;
+        u8 pendingCount;
+
+        // Worker buffers
+        std::vector<u8> incoming;
+        std::vector<u8> delta;
+
+        Stats stats;
+
+        bool busy;
+        bool stop;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        std::thread worker;
+
+        void work();
+
+        void encodeDelta();
+        void applyDelta(const std::vector<u8>& delta);
+
+        void copyToRing(size_t position, const u8* data, const size_t size);
+        void copyFromRing(size_t position, u8* data, const size_t size) const;
+
+        void push(const std::vector<u8>& delta);
+        bool pop(std::vector<u8>& delta);
+        void dropOldest();
+
+    public:
+        Rewind(const u16 interval, const size_t capacity);
+        ~Rewind();
+
+        Rewind(const Rewind&) = delete;
+        Rewind& operator=(const Rewind&) = delete;
+
+        // Forget the history, for when another ROM is loaded
+        void clear();
+
+        // Called by GameBoy::step after every frame, never waits for the worker
+        void frame(const GameBoy& gameboy);
+
+        // Load the snapshot before the newest one, returns false once the history is used up
+        bool rewind(GameBoy& gameboy);
+
+        Stats getStats();
+};
\ No newline at end of file
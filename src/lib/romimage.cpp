@@ -0,0 +1,178 @@
+#include "romimage.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
+// Images still held by some Cart, keyed by canonical path
+static std::mutex cacheMutex;
+static std::unordered_map<std::string, std::weak_ptr<const ROMImage>> cache;
+
+ROMImage::ROMImage() : data(nullptr), size(0), fileSize(0), modified(0), headerChecksumValid(false), globalChecksum(Checksum::Unknown)
+{
+
+}
+
+ROMImage::~ROMImage()
+{
+    #ifndef _WIN32
+        if(this->data && !this->buffer)
+            munmap(const_cast<u8*>(this->data), this->fileSize);
+    #endif
+}
+
+std::shared_ptr<const ROMImage> ROMImage::open(const std::string& path, const size_t minimumSize)
+{
+    std::error_code error;
+
+    const std::filesystem::path canonical = std::filesystem::canonical(path, error);
+    if(error)
+        return nullptr;
+
+    const size_t fileSize = std::filesystem::file_size(canonical, error);
+    if(error || !fileSize)
+        return nullptr;
+
+    const u64 modified = std::filesystem::last_write_time(canonical, error).time_since_epoch().count();
+    if(error)
+        return nullptr;
+
+    // Held while mapping so instances loading the same ROM at once don't map it twice
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    const std::string key = canonical.string();
+    const auto entry = cache.find(key);
+
+    if(entry != cache.end())
+    {
+        std::shared_ptr<const ROMImage> image = entry->second.lock();
+
+        if(image && image->fileSize == fileSize && image->modified == modified && image->size >= minimumSize)
+            return image;
+    }
+
+    std::shared_ptr<const ROMImage> image = ROMImage::create(key, fileSize, minimumSize, modified);
+
+    if(!image)
+        return nullptr;
+
+    // Drop the entries of images nobody holds anymore while the map is locked anyway
+    std::erase_if(cache, [](const auto& entry) { return entry.second.expired(); });
+    cache[key] = image;
+
+    return image;
+}
+
+std::shared_ptr<const ROMImage> ROMImage::create(const std::string& path, const size_t fileSize, const size_t minimumSize, const u64 modified)
+{
+    std::shared_ptr<ROMImage> image(new ROMImage());
+    image->size = std::max(fileSize, minimumSize);
+    image->fileSize = fileSize;
+    image->modified = modified;
+
+    #ifndef _WIN32
+        if(fileSize >= minimumSize)
+        {
+            const int file = ::open(path.c_str(), O_RDONLY);
+
+            if(file < 0)
+                return nullptr;
+
+            // The mapping keeps the file referenced, the descriptor isn't needed past this
+            void* memory = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+            close(file);
+
+            if(memory == MAP_FAILED)
+                return nullptr;
+
+            image->data = static_cast<const u8*>(memory);
+            image->verifyHeaderChecksum();
+
+            return image;
+        }
+    #endif
+
+    FILE* file = fopen(path.c_str(), "rb");
+
+    if(!file)
+        return nullptr;
+
+    image->buffer = std::make_unique<u8[]>(image->size);
+    const size_t read = fread(image->buffer.get(), sizeof(u8), fileSize, file);
+    fclose(file);
+
+    if(read != fileSize)
+        return nullptr;
+
+    // Reads past the end of a short ROM chip see an undriven bus
+    memset(image->buffer.get() + fileSize, 0xFF, image->size - fileSize);
+
+    image->data = image->buffer.get();
+    image->verifyHeaderChecksum();
+
+    return image;
+}
+
+void ROMImage::verifyHeaderChecksum()
+{
+    if(this->fileSize < ROMImage::headerEnd)
+        return;
+
+    u8 headerChecksum = 0;
+    for(u16 addr = 0x134; addr <= 0x14C; ++addr)
+        headerChecksum = headerChecksum - this->data[addr] - 1;
+
+    this->headerChecksumValid = headerChecksum == this->data[0x14D];
+}
+
+const u8* ROMImage::getData() const
+{
+    return this->data;
+}
+
+size_t ROMImage::getSize() const
+{
+    return this->size;
+}
+
+size_t ROMImage::getFileSize() const
+{
+    return this->fileSize;
+}
+
+bool ROMImage::isHeaderChecksumValid() const
+{
+    return this->headerChecksumValid;
+}
+
+bool ROMImage::isGlobalChecksumValid() const
+{
+    Checksum checksum = this->globalChecksum.load(std::memory_order_relaxed);
+
+    if(checksum != Checksum::Unknown)
+        return checksum == Checksum::Valid;
+
+    if(this->fileSize < ROMImage::headerEnd)
+        return false;
+
+    // Sum of every byte of the file but the checksum itself
+    u16 sum = 0;
+    for(size_t addr = 0; addr < this->fileSize; ++addr)
+        sum += this->data[addr];
+
+    sum -= this->data[0x14E] + this->data[0x14F];
+
+    checksum = sum == ((this->data[0x14E] << 8) | this->data[0x14F]) ? Checksum::Valid : Checksum::Invalid;
+    this->globalChecksum.store(checksum, std::memory_order_relaxed);
+
+    return checksum == Checksum::Valid;
+}
\ No newline at end of file
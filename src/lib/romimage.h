@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include "types.h"
+
+// Immutable ROM file contents shared between every Cart that loads the same file. The file is
+// mapped read-only, so the pages are the OS page cache's and nothing is copied. Images are
+// cached by path for as long as any Cart holds them, loading a ROM another instance already
+// has open costs a lookup.
+class ROMImage
+{
+    public:
+        // Cartridge header, 0x0100-0x014F
+        static constexpr size_t headerEnd = 0x150;
+
+    private:
+        const u8* data;
+        size_t size;
+        size_t fileSize;
+
+        // Holds a padded copy of a file shorter than its banks, or the file where mmap isn't
+        // available. Empty when data is a mapping.
+        std::unique_ptr<u8[]> buffer;
+
+        // A cached image is only reused while the file still has this write time, a rewritten
+        // file gets a new image
+        u64 modified;
+
+        // Worked out when the image is created, every Cart sharing it reads the result
+        bool headerChecksumValid;
+
+        // Sums every byte of the file, so it's only worked out on the first call to
+        // isGlobalChecksumValid instead of faulting in the whole mapping on load. Carts racing
+        // to it compute the same value.
+        enum class Checksum : u8
+        {
+            Unknown,
+            Valid,
+            Invalid,
+        };
+
+        mutable std::atomic<Checksum> globalChecksum;
+
+        ROMImage();
+
+        static std::shared_ptr<const ROMImage> create(const std::string& path, const size_t fileSize, const size_t minimumSize, const u64 modified);
+
+        void verifyHeaderChecksum();
+
+    public:
+        ~ROMImage();
+
+        ROMImage(const ROMImage&) = delete;
+        ROMImage& operator=(const ROMImage&) = delete;
+
+        // Returns the cached image or maps the file, nullptr if it can't be opened. A file
+        // shorter than minimumSize is copied instead and the rest filled with 0xFF, so every
+        // bank the header declares can be read. Safe to call from several threads.
+        static std::shared_ptr<const ROMImage> open(const std::string& path, const size_t minimumSize = 0);
+
+        const u8* getData() const;
+
+        // Readable bytes, at least minimumSize
+        size_t getSize() const;
+
+        // Bytes the file actually has
+        size_t getFileSize() const;
+
+        // The boot ROM refuses to start a cart with a wrong header checksum (0x014D), the
+        // global checksum (0x014E-0x014F) isn't checked by anything. The first call to
+        // isGlobalChecksumValid reads the whole file.
+        bool isHeaderChecksumValid() const;
+        bool isGlobalChecksumValid() const;
+};
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include "savefile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/file.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+// Longest a written page waits to be handed to the worker
+static constexpr std::chrono::nanoseconds flushInterval = std::chrono::seconds(1);
+
+static u64 getTime()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+SaveFile::SaveFile(u8* data, const size_t size, const int file) : data(data), size(size), file(file), pageSize(0x1000), dirty(0), lastHandoff(getTime()), pending(0), stop(false)
+{
+    #ifndef _WIN32
+        this->pageSize = std::max<size_t>(sysconf(_SC_PAGESIZE), 0x1000);
+    #endif
+
+    // Keeps the dirty mask in one word whatever the RAM size
+    while(this->size > this->pageSize * 64)
+        this->pageSize *= 2;
+
+    this->worker = std::thread(&SaveFile::work, this);
+}
+
+SaveFile::~SaveFile()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+    }
+
+    this->wake.notify_all();
+    this->worker.join();
+
+    // Closing the ROM writes everything back, not just what the worker was handed
+    this->sync(this->dirty | this->pending);
+
+    #ifndef _WIN32
+        munmap(this->data, this->size);
+        close(this->file);
+    #endif
+}
+
+std::unique_ptr<SaveFile> SaveFile::open(const std::string& path, const size_t size)
+{
+    #ifndef _WIN32
+        const int file = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+
+        if(file < 0)
+            return nullptr;
+
+        // Instances writing the same RAM would race, so the file belongs to whoever opened it first.
+        // flock locks are per open file, which keeps out other instances in this process too.
+        if(flock(file, LOCK_EX | LOCK_NB) != 0)
+        {
+            close(file);
+            return nullptr;
+        }
+
+        // A new file reads as zeros, a longer one (like an RTC footer from another emulator) is
+        // left as it is and only its start is mapped
+        struct stat status;
+        if(fstat(file, &status) != 0 || (static_cast<size_t>(status.st_size) < size && ftruncate(file, size) != 0))
+        {
+            close(file);
+            return nullptr;
+        }
+
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+
+        if(memory == MAP_FAILED)
+        {
+            close(file);
+            return nullptr;
+        }
+
+        return std::unique_ptr<SaveFile>(new SaveFile(static_cast<u8*>(memory), size, file));
+    #else
+        return nullptr;
+    #endif
+}
+
+u8* SaveFile::getData() const
+{
+    return this->data;
+}
+
+void SaveFile::write(const u8* source)
+{
+    for(size_t start = 0, page = 0; start < this->size; start += this->pageSize, ++page)
+    {
+        const size_t length = std::min(this->pageSize, this->size - start);
+
+        if(memcmp(this->data + start, source + start, length) == 0)
+            continue;
+
+        memcpy(this->data + start, source + start, length);
+        this->dirty |= 1ull << page;
+    }
+}
+
+bool SaveFile::frame()
+{
+    if(!this->dirty)
+        return false;
+
+    const u64 now = getTime();
+
+    if(now - this->lastHandoff < static_cast<u64>(flushInterval.count()))
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->pending |= this->dirty;
+    }
+
+    this->wake.notify_one();
+
+    this->dirty = 0;
+    this->lastHandoff = now;
+
+    return true;
+}
+
+// =================================================================================
+// Worker
+// =================================================================================
+
+void SaveFile::work()
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    while(true)
+    {
+        this->wake.wait(lock, [this]() { return this->stop || this->pending; });
+
+        if(this->stop)
+            return;
+
+        const u64 pages = this->pending;
+        this->pending = 0;
+
+        // The emulation thread keeps writing to the mapping while this blocks in msync
+        lock.unlock();
+        this->sync(pages);
+        lock.lock();
+    }
+}
+
+void SaveFile::sync(const u64 pages)
+{
+    #ifndef _WIN32
+        const size_t count = (this->size + this->pageSize - 1) / this->pageSize;
+
+        // One msync per run of consecutive dirty pages
+        size_t page = 0;
+        while(page < count)
+        {
+            if(!(pages & (1ull << page)))
+            {
+                ++page;
+                continue;
+            }
+
+            const size_t first = page;
+            while(page < count && (pages & (1ull << page)))
+                ++page;
+
+            const size_t start = first * this->pageSize;
+            const size_t end = std::min(page * this->pageSize, this->size);
+            msync(this->data + start, end - start, MS_SYNC);
+        }
+    #endif
+}
\ No newline at end of file
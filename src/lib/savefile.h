@@ -0,0 +1,75 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <thread>
+#include "types.h"
+
+// Battery-backed cart RAM kept in a .sav file. The file is mapped shared, so the MBC reads and
+// writes the file's page cache directly and nothing is lost if the process dies. The emulation
+// thread only records which pages changed; once per flush interval it hands them to a worker
+// thread that msyncs them, so a crash of the whole system loses at most one interval. Anything
+// written to the RAM can reach the file, including run-ahead frames that are later rolled back.
+class SaveFile
+{
+    private:
+        u8* data;
+        size_t size;
+
+        // Kept open for the lock that stops two instances from sharing the mapping
+        int file;
+
+        // Dirty pages are tracked at the host page size msync works in, one bit each. The
+        // largest cart RAM is 128 KiB, 32 pages of 4 KiB.
+        size_t pageSize;
+
+        // Pages written since the last handoff, only touched by the emulation thread
+        u64 dirty;
+        u64 lastHandoff; // Steady clock nanoseconds
+
+        // Pages handed to the worker and not synced yet
+        u64 pending;
+        bool stop;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::thread worker;
+
+        SaveFile(u8* data, const size_t size, const int file);
+
+        void work();
+        void sync(const u64 pages);
+
+    public:
+        ~SaveFile();
+
+        SaveFile(const SaveFile&) = delete;
+        SaveFile& operator=(const SaveFile&) = delete;
+
+        // Maps the file, creating it or growing it to size first. Returns nullptr if it can't be
+        // opened, another SaveFile in this or another process holds it, or mmap isn't available.
+        static std::unique_ptr<SaveFile> open(const std::string& path, const size_t size);
+
+        u8* getData() const;
+
+        bool isDirty(const size_t offset) const
+        {
+            return this->dirty & (1ull << (offset / this->pageSize));
+        }
+
+        void markDirty(const size_t offset)
+        {
+            this->dirty |= 1ull << (offset / this->pageSize);
+        }
+
+        // Copy a whole RAM image in, like from a save state. Only pages whose contents differ are
+        // written and marked dirty, so reloading a state every frame (run-ahead, rewind) doesn't
+        // make the worker msync the entire file.
+        void write(const u8* source);
+
+        // Called by GameBoy::step after every frame. Hands the dirty pages to the worker once the
+        // interval has passed and returns true, after which writes need to be caught again.
+        bool frame();
+};
\ No newline at end of file
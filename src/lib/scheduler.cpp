@@ -0,0 +1,184 @@
+#include "scheduler.h"
+
+#include <utility>
+
+Scheduler::Scheduler()
+{
+    this->restart();
+}
+
+void Scheduler::restart()
+{
+    this->size = 0;
+    this->position.fill(unscheduled);
+
+    this->now = 0;
+    this->limit = 0;
+    this->deadline = 0;
+}
+
+void Scheduler::saveState(StateWriter& state) const
+{
+    // Slots past size hold whatever was removed last, zeros keep equal machines' states equal
+    for(u8 index = 0; index < Scheduler::eventCount; ++index)
+    {
+        const Entry entry = index < this->size ? this->heap[index] : Entry{0, Event::Count};
+        state.write(entry.timestamp);
+        state.write(entry.event);
+    }
+
+    state.write(this->position);
+    state.write(this->size);
+    state.write(this->limit);
+    state.write(this->now);
+    state.write(this->deadline);
+}
+
+void Scheduler::loadState(StateReader& state)
+{
+    for(Entry& entry : this->heap)
+    {
+        state.read(entry.timestamp);
+        state.read(entry.event);
+    }
+
+    state.read(this->position);
+    state.read(this->size);
+    state.read(this->limit);
+    state.read(this->now);
+    state.read(this->deadline);
+}
+
+// =================================================================================
+// Heap
+// =================================================================================
+
+void Scheduler::swap(const u8 a, const u8 b)
+{
+    std::swap(this->heap[a], this->heap[b]);
+
+    this->position[static_cast<u8>(this->heap[a].event)] = a;
+    this->position[static_cast<u8>(this->heap[b].event)] = b;
+}
+
+void Scheduler::siftUp(u8 index)
+{
+    while(index > 0)
+    {
+        const u8 parent = (index - 1) / 2;
+        if(this->heap[parent].timestamp <= this->heap[index].timestamp)
+            break;
+
+        this->swap(parent, index);
+        index = parent;
+    }
+}
+
+void Scheduler::siftDown(u8 index)
+{
+    while(true)
+    {
+        const u8 left = index * 2 + 1;
+        const u8 right = index * 2 + 2;
+        u8 smallest = index;
+
+        if(left < this->size && this->heap[left].timestamp < this->heap[smallest].timestamp)
+            smallest = left;
+
+        if(right < this->size && this->heap[right].timestamp < this->heap[smallest].timestamp)
+            smallest = right;
+
+        if(smallest == index)
+            break;
+
+        this->swap(smallest, index);
+        index = smallest;
+    }
+}
+
+void Scheduler::remove(const u8 index)
+{
+    this->position[static_cast<u8>(this->heap[index].event)] = unscheduled;
+
+    --this->size;
+    if(index == this->size)
+        return;
+
+    // Move the last entry into the hole and restore the heap order around it
+    const u8 moved = static_cast<u8>(this->heap[this->size].event);
+    this->heap[index] = this->heap[this->size];
+    this->position[moved] = index;
+
+    this->siftUp(index);
+    this->siftDown(this->position[moved]);
+}
+
+void Scheduler::updateDeadline()
+{
+    this->deadline = this->limit;
+
+    if(this->size && this->heap[0].timestamp < this->deadline)
+        this->deadline = this->heap[0].timestamp;
+}
+
+// =================================================================================
+// Events
+// =================================================================================
+
+void Scheduler::schedule(Event event, const u64 timestamp)
+{
+    const u8 id = static_cast<u8>(event);
+
+    if(this->position[id] == unscheduled)
+    {
+        this->heap[this->size] = Entry{timestamp, event};
+        this->position[id] = this->size;
+        ++this->size;
+
+        this->siftUp(this->position[id]);
+    }
+    else
+    {
+        const u8 index = this->position[id];
+        this->heap[index].timestamp = timestamp;
+
+        this->siftUp(index);
+        this->siftDown(this->position[id]);
+    }
+
+    this->updateDeadline();
+}
+
+void Scheduler::cancel(Event event)
+{
+    const u8 id = static_cast<u8>(event);
+
+    if(this->position[id] == unscheduled)
+        return;
+
+    this->remove(this->position[id]);
+    this->updateDeadline();
+}
+
+bool Scheduler::isScheduled(Event event) const
+{
+    return this->position[static_cast<u8>(event)] != unscheduled;
+}
+
+void Scheduler::setLimit(const u64 limit)
+{
+    this->limit = limit;
+    this->updateDeadline();
+}
+
+bool Scheduler::popDue(Event& event)
+{
+    if(!this->size || this->heap[0].timestamp > this->now)
+        return false;
+
+    event = this->heap[0].event;
+    this->remove(0);
+    this->updateDeadline();
+
+    return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include "types.h"
+#include "state.h"
+
+// Cycle-timestamped event queue. Subsystems register the cycle at which they next need
+// to run and the CPU executes uninterrupted until the earliest of those deadlines.
+class Scheduler
+{
+    public:
+        enum class Event : u8
+        {
+            PPU,
+            Timer,
+            Count,
+        };
+
+    private:
+        static constexpr u8 eventCount = static_cast<u8>(Event::Count);
+        static constexpr u8 unscheduled = 0xFF;
+
+        struct Entry
+        {
+            u64 timestamp;
+            Event event;
+        };
+
+        // Binary min-heap ordered by timestamp, position maps an event to its heap index
+        std::array<Entry, eventCount> heap;
+        std::array<u8, eventCount> position;
+        u8 size;
+
+        u64 limit;
+
+        void swap(const u8 a, const u8 b);
+        void siftUp(u8 index);
+        void siftDown(u8 index);
+        void remove(const u8 index);
+
+        void updateDeadline();
+
+    public:
+        // Cycles elapsed since power on, advanced by the CPU after every instruction
+        u64 now;
+
+        // Earliest pending event or the run limit, whichever comes first
+        u64 deadline;
+
+        Scheduler();
+
+        void restart();
+
+        void saveState(StateWriter& state) const;
+        void loadState(StateReader& state);
+
+        void schedule(Event event, const u64 timestamp);
+        void cancel(Event event);
+        bool isScheduled(Event event) const;
+
+        // Run until at most this cycle even if no event is due earlier
+        void setLimit(const u64 limit);
+
+        // Pop the earliest event if it is due, return false once none are
+        bool popDue(Event& event);
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <span>
+#include <string.h>
+#include <type_traits>
+#include "types.h"
+
+// Cursor over a caller-provided save state buffer. Fields are copied raw in host byte order.
+// Writing past the end only counts the bytes, so running a save against an empty span
+// measures the state size.
+class StateWriter
+{
+    private:
+        std::span<u8> buffer;
+        size_t offset;
+
+    public:
+        StateWriter(std::span<u8> buffer) : buffer(buffer), offset(0)
+        {
+
+        }
+
+        size_t getSize() const
+        {
+            return this->offset;
+        }
+
+        bool isOverflowed() const
+        {
+            return this->offset > this->buffer.size();
+        }
+
+        void writeBytes(const void* data, const size_t size)
+        {
+            if(this->offset + size <= this->buffer.size())
+                memcpy(this->buffer.data() + this->offset, data, size);
+
+            this->offset += size;
+        }
+
+        // Structs with padding have to be written field by field, or the padding bytes make
+        // equal machines save different states
+        template<typename T> void write(const T& val)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            static_assert(std::has_unique_object_representations_v<T>);
+            this->writeBytes(&val, sizeof(T));
+        }
+};
+
+class StateReader
+{
+    private:
+        std::span<const u8> buffer;
+        size_t offset;
+
+    public:
+        StateReader(std::span<const u8> buffer) : buffer(buffer), offset(0)
+        {
+
+        }
+
+        size_t getSize() const
+        {
+            return this->offset;
+        }
+
+        bool isOverflowed() const
+        {
+            return this->offset > this->buffer.size();
+        }
+
+        void readBytes(void* data, const size_t size)
+        {
+            if(this->offset + size <= this->buffer.size())
+                memcpy(data, this->buffer.data() + this->offset, size);
+
+            this->offset += size;
+        }
+
+        // The next size bytes in place, for callers that only copy part of them. Returns nullptr if the buffer is too short.
+        const u8* readView(const size_t size)
+        {
+            const u8* data = this->offset + size <= this->buffer.size() ? this->buffer.data() + this->offset : nullptr;
+            this->offset += size;
+            return data;
+        }
+
+        template<typename T> void read(T& val)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            static_assert(std::has_unique_object_representations_v<T>);
+            this->readBytes(&val, sizeof(T));
+        }
+};
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 #include "gameboy.h"
 
-Timer::Timer(Bus& bus, Interrupts& interrupts) : bus(bus), interrupts(interrupts)
+Timer::Timer(Bus& bus, Interrupts& interrupts, Scheduler& scheduler, const Options& options) : bus(bus), interrupts(interrupts), scheduler(scheduler), options(options)
 {
     this->restart();
 }
@@ -10,63 +10,157 @@ Timer::Timer(Bus& bus, Interrupts& interrupts) : bus(bus), interrupts(interrupts
 void Timer::restart()
 {
     tima = 0;
-    tma = 0;    
-    divCycleCounter = 0; 
-    timaCycleCounter = 0;
+    tma = 0;
+    timaBase = this->scheduler.now;
+    suspendedTimaCycles = 0;
 
-    if(GameBoy::skipBootROM)
+    if(this->options.skipBootROM)
     {
         tac = 0xF8;
-        div = 0xAB;
+        divBase = this->scheduler.now - 0xAB00;
     }
     else
     {
         tac = 0;
-        div = 0;
+        divBase = this->scheduler.now;
     }
+
+    this->scheduleOverflow();
 }
 
-void Timer::step(const u8 cycles)
+void Timer::saveState(StateWriter& state) const
 {
-    this->divCycleCounter += cycles;
+    state.write(this->tima);
+    state.write(this->tma);
+    state.write(this->tac);
+    state.write(this->divBase);
+    state.write(this->timaBase);
+    state.write(this->suspendedTimaCycles);
+}
 
-    while(this->divCycleCounter >= 256)
-    {
-        this->divCycleCounter -= 256;
-        ++this->div;
-    }
+void Timer::loadState(StateReader& state)
+{
+    state.read(this->tima);
+    state.read(this->tma);
+    state.read(this->tac);
+    state.read(this->divBase);
+    state.read(this->timaBase);
+    state.read(this->suspendedTimaCycles);
+}
 
-    if(!(this->tac & 0x4))
-        return;
+// =================================================================================
+// Helper Functions
+// =================================================================================
 
-    this->timaCycleCounter += cycles;
+bool Timer::isEnabled() const
+{
+    return this->tac & 0x4;
+}
 
-    u16 frequency = 0;
+u16 Timer::getFrequency() const
+{
     switch(this->tac & 0x3)
     {
         case 0:
-            frequency = 1024;
-            break;
+            return 1024;
         case 1:
-            frequency = 16;
-            break;
+            return 16;
         case 2:
-            frequency = 64;
-            break;
-        case 3:
-            frequency = 256;
-            break;
+            return 64;
+        default:
+            return 256;
     }
+}
 
-    while(this->timaCycleCounter >= frequency)
+void Timer::sync()
+{
+    if(!this->isEnabled())
+        return;
+
+    const u16 frequency = this->getFrequency();
+    u64 ticks = (this->scheduler.now - this->timaBase) / frequency;
+
+    // Overflow reloads TIMA from TMA and requests the interrupt
+    while(this->tima + ticks > 0xFF)
+    {
+        const u16 toOverflow = 0x100 - this->tima;
+        ticks -= toOverflow;
+        this->timaBase += toOverflow * frequency;
+
+        this->tima = this->tma;
+        this->interrupts.setFlag(Interrupts::Interrupt::Timer, true);
+    }
+
+    this->tima += ticks;
+    this->timaBase += ticks * frequency;
+}
+
+void Timer::scheduleOverflow()
+{
+    if(!this->isEnabled())
     {
-        this->timaCycleCounter -= frequency;
-        ++this->tima;
-
-        if(this->tima == 0)
-        {
-            this->tima = this->tma;
-            this->interrupts.setFlag(Interrupts::Interrupt::Timer, true);
-        }
+        this->scheduler.cancel(Scheduler::Event::Timer);
+        return;
     }
+
+    this->scheduler.schedule(Scheduler::Event::Timer, this->timaBase + (0x100 - this->tima) * this->getFrequency());
+}
+
+// =================================================================================
+// Registers
+// =================================================================================
+
+u8 Timer::readDIV() const
+{
+    return static_cast<u16>(this->scheduler.now - this->divBase) >> 8;
+}
+
+u8 Timer::readTIMA()
+{
+    this->sync();
+    return this->tima;
+}
+
+void Timer::writeDIV()
+{
+    this->sync();
+    this->divBase = this->scheduler.now;
+    this->scheduleOverflow();
+}
+
+void Timer::writeTIMA(const u8 val)
+{
+    this->sync();
+    this->tima = val;
+    this->scheduleOverflow();
+}
+
+void Timer::writeTMA(const u8 val)
+{
+    this->sync();
+    this->tma = val;
+    this->scheduleOverflow();
+}
+
+void Timer::writeTAC(const u8 val)
+{
+    this->sync();
+
+    const bool wasEnabled = this->isEnabled();
+    this->tac = val;
+    const bool enabled = this->isEnabled();
+
+    // The TIMA period is frozen while the timer is disabled and resumes where it left off
+    if(wasEnabled && !enabled)
+        this->suspendedTimaCycles = this->scheduler.now - this->timaBase;
+    else if(!wasEnabled && enabled)
+        this->timaBase = this->scheduler.now - this->suspendedTimaCycles;
+
+    this->scheduleOverflow();
+}
+
+void Timer::step()
+{
+    this->sync();
+    this->scheduleOverflow();
 }
\ No newline at end of file
@@ -1,28 +1,57 @@
 #pragma once
 
 #include "types.h"
+#include "state.h"
+#include "options.h"
 #include "bus.h"
 #include "interrupts.h"
+#include "scheduler.h"
 
+// DIV and TIMA are not ticked, they are derived from the scheduler's cycle count when
+// read. The only event is the TIMA overflow, which is rescheduled whenever a timer
+// register is written.
 class Timer
 {
     private:
-        u16 div;
         u8 tima;
         u8 tma;
         u8 tac;
 
-        u16 divCycleCounter;
-        u8 timaCycleCounter;
+        // The 16-bit system counter whose upper byte is DIV is now - divBase
+        u64 divBase;
+
+        // TIMA last caught up at timaBase, cycles into the current TIMA period are frozen in
+        // suspendedTimaCycles while TAC is disabled
+        u64 timaBase;
+        u16 suspendedTimaCycles;
 
         Interrupts& interrupts;
         Bus& bus;
+        Scheduler& scheduler;
+        const Options& options;
         friend class Bus;
 
+        bool isEnabled() const;
+        u16 getFrequency() const;
+
+        void sync();
+        void scheduleOverflow();
+
+        u8 readDIV() const;
+        u8 readTIMA();
+        void writeDIV();
+        void writeTIMA(const u8 val);
+        void writeTMA(const u8 val);
+        void writeTAC(const u8 val);
+
     public:
-        Timer(Bus& bus, Interrupts& interrupts);
+        Timer(Bus& bus, Interrupts& interrupts, Scheduler& scheduler, const Options& options);
 
         void restart();
 
-        void step(const u8 cycles);
-};
\ No newline at end of file
+        void saveState(StateWriter& state) const;
+        void loadState(StateReader& state);
+
+        // Scheduler event, fires when TIMA overflows
+        void step();
+};
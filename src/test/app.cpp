@@ -5,7 +5,8 @@
 #endif
 
 float App::refreshRatePeriod = 16.67;
-App::App() : window(nullptr), renderer(nullptr), displayTexture(nullptr), quit(false)
+int App::runAheadFrames = 0;
+App::App() : window(nullptr), renderer(nullptr), displayTexture(nullptr), quit(false), rewinding(false)
 {
     this->loadMedia();
 
@@ -19,7 +20,7 @@ App::~App()
     // this->gameboy.uninitNcurses();
 
     #ifdef ERROR
-        ErrorCollector::printErrors(true);
+        this->gameboy.getErrors().printErrors(true);
     #endif
 }
 
@@ -27,7 +28,7 @@ void App::loadMedia()
 {
     this->window = SDL_CreateWindow("Game Boy Emulator", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 160 * 5, 144 * 5, SDL_WINDOW_SHOWN);
     this->renderer = SDL_CreateRenderer(this->window, -1, SDL_RENDERER_ACCELERATED);
-    this->displayTexture = SDL_CreateTexture(this->renderer, SDL_PIXELFORMAT_RGB24, SDL_TEXTUREACCESS_STREAMING, 160, 144);
+    this->displayTexture = SDL_CreateTexture(this->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, 160, 144);
 
     GUI::init(this->window, this->renderer);
 }
@@ -42,7 +43,7 @@ void App::freeMedia()
     SDL_Quit();
 }
 
-void App::start(std::string bootROMPath, std::string romPath)
+bool App::start(std::string bootROMPath, std::string romPath)
 {
     this->lastCycleTime = std::chrono::steady_clock::now();
 
@@ -76,8 +77,18 @@ void App::start(std::string bootROMPath, std::string romPath)
 
     // this->gameboy.createGameBoyDoctorLog();
 
-    this->gameboy.loadROM(romPath);
+    // Games save to a .sav file next to the ROM, like on a cart with a battery
+    this->gameboy.options.batterySaves = true;
+
+    if(!this->gameboy.loadROM(romPath))
+        return false;
+
     this->gameboy.loadBootROM(bootROMPath);
+
+    // A snapshot every other frame, a minute of history takes well under the 4 MB in most games
+    this->gameboy.setRewind(2, 4 * 1024 * 1024);
+
+    return true;
 }
 
 void App::update()
@@ -99,6 +110,9 @@ void App::update()
                     case SDLK_TAB:
                         this->refreshRatePeriod = 0.1;
                         break;
+                    case SDLK_BACKSPACE:
+                        this->rewinding = true;
+                        break;
                     case SDLK_m:
                         GUI::menuEnable = !GUI::menuEnable;
                         break;
@@ -134,6 +148,9 @@ void App::update()
                     case SDLK_TAB:
                         this->refreshRatePeriod = 16.67;
                         break;
+                    case SDLK_BACKSPACE:
+                        this->rewinding = false;
+                        break;
                     case SDLK_UP:
                         this->gameboy.releaseButton(Joypad::Button::Up);
                         break;
@@ -172,7 +189,10 @@ void App::update()
     {
         lastCycleTime = currentTime;
 
-        this->gameboy.step();
+        if(this->rewinding)
+            this->gameboy.rewind();
+        else
+            this->gameboy.runAhead(App::runAheadFrames);
     }
 
     // This sucks, sleeping takes time... throttling needs to be changed to use manual tick counting
@@ -185,7 +205,7 @@ void App::draw()
 
     SDL_RenderClear(this->renderer);
 
-    SDL_UpdateTexture(this->displayTexture, nullptr, this->gameboy.getFramebuffer().data(), 160 * (sizeof(u8) * 3));
+    SDL_UpdateTexture(this->displayTexture, nullptr, this->gameboy.getFramebuffer(PPU::PixelFormat::ARGB8888).data(), 160 * sizeof(u32));
     SDL_RenderCopy(this->renderer, this->displayTexture, nullptr, nullptr);
 
     GUI::draw(this->renderer, *this);
@@ -19,14 +19,23 @@ class App
     public:
         static float refreshRatePeriod;
 
+        // Frames emulated ahead of the one shown to hide the game's input lag, 0 turns it off
+        static int runAheadFrames;
+
         bool quit;
 
+        // Backspace is held, frames step back through the rewind history instead of forward
+        bool rewinding;
+
         GameBoy gameboy;
 
+        // Quick save slot for the Game menu
+        std::vector<u8> savedState;
+
         App();
         ~App();
 
-        void start(std::string bootROMPath, std::string ROMPath);
+        bool start(std::string bootROMPath, std::string ROMPath);
         void update();
         void draw();
 };
\ No newline at end of file
@@ -37,7 +37,7 @@ void GUI::drawMenu(App& app)
         {
             ImGui::SeparatorText("State");
 
-            ImGui::Checkbox("Skip Boot ROM", &GameBoy::skipBootROM);
+            ImGui::Checkbox("Skip Boot ROM", &app.gameboy.options.skipBootROM);
 
             if(ImGui::MenuItem("Reboot"))
                 app.gameboy.reboot();
@@ -46,6 +46,18 @@ void GUI::drawMenu(App& app)
 
             ImGui::DragFloat("Refresh Rate Period", &App::refreshRatePeriod, 1, 0.1, 100);
 
+            ImGui::Checkbox("Idle Loop Detection", &app.gameboy.options.idleLoopDetection);
+
+            ImGui::SliderInt("Run-Ahead Frames", &App::runAheadFrames, 0, 4);
+
+            const GameBoy::RunAheadStats runAhead = app.gameboy.getRunAheadStats();
+            if(runAhead.frames)
+                ImGui::Text("Run-ahead: save %.1f us, load %.1f us, frame %.0f us", runAhead.saveNanoseconds / 1e3 / runAhead.frames, runAhead.loadNanoseconds / 1e3 / runAhead.frames, runAhead.totalNanoseconds / 1e3 / runAhead.frames);
+
+            #ifdef CPU_JIT
+                ImGui::Checkbox("JIT Lockstep", &app.gameboy.options.jitLockstep);
+            #endif
+
             if(ImGui::MenuItem("Reset Refresh Rate Period"))
             {
                 App::refreshRatePeriod = 16.67;
@@ -66,17 +78,16 @@ void GUI::drawMenu(App& app)
             ImGui::Text("%s", app.gameboy.getTitle().c_str());
             ImGui::Spacing();
 
-            // ImGui::SeparatorText("Saving");
-
-            // if(ImGui::MenuItem("Save"))
-            // {
-                
-            // }
+            ImGui::SeparatorText("Saving");
 
-            // if(ImGui::MenuItem("Load"))
-            // {
+            if(ImGui::MenuItem("Save"))
+            {
+                app.savedState.resize(app.gameboy.getStateSize());
+                app.gameboy.saveState(app.savedState);
+            }
 
-            // }
+            if(ImGui::MenuItem("Load", nullptr, false, !app.savedState.empty()))
+                app.gameboy.loadState(app.savedState);
 
             ImGui::EndMenu();
         }
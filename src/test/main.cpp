@@ -29,7 +29,12 @@ int main(int argc, char* argv[])
     }
 
     App app;
-    app.start(argv[1], argv[2]);
+
+    if(!app.start(argv[1], argv[2]))
+    {
+        fprintf(stderr, "ERROR::CLI::COULD_NOT_LOAD_ROM\n");
+        return EXIT_FAILURE;
+    }
 
     while(!app.quit)
     {